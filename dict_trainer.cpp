@@ -0,0 +1,221 @@
+// 预置字典训练工具：从抓取的消息中选出出现最广的片段，生成permessage-deflate预置字典
+//
+// 用法: websocket_dict_trainer [-s 字典大小] [-k 片段长度] [-o 输出文件] 样本文件...
+// 样本文件每行一条消息
+#include "websocket_client.hpp"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+
+namespace {
+
+const size_t kDmer = 6;   // 统计频率的子串长度
+
+struct TrainerOptions {
+    size_t dict_size = 4096;
+    size_t segment_size = 32;
+    std::string output = "dictionary.bin";
+    std::vector<std::string> inputs;
+};
+
+struct Segment {
+    size_t offset;
+    size_t length;
+    uint64_t score;
+};
+
+uint64_t dmerHash(const char* p) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < kDmer; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(p[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool loadSamples(const std::vector<std::string>& inputs, std::vector<std::string>& samples) {
+    for (const auto& path : inputs) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cerr << "无法打开样本文件: " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) samples.push_back(line);
+        }
+    }
+    return true;
+}
+
+// 按样本统计每个子串出现在多少条消息中，出现得越广越值得放进字典
+std::unordered_map<uint64_t, uint32_t> countDmers(const std::vector<std::string>& samples) {
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> seen;   // hash -> (消息数, 最近一条消息序号+1)
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const std::string& s = samples[i];
+        for (size_t pos = 0; pos + kDmer <= s.size(); ++pos) {
+            auto& entry = seen[dmerHash(s.data() + pos)];
+            if (entry.second != i + 1) {
+                entry.first++;
+                entry.second = static_cast<uint32_t>(i + 1);
+            }
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> freq;
+    freq.reserve(seen.size());
+    for (const auto& item : seen) {
+        // 只出现在一条消息中的子串对其他消息没有帮助
+        if (item.second.first > 1) freq[item.first] = item.second.first;
+    }
+    return freq;
+}
+
+// 把所有样本分成若干段，每段选出得分最高的片段，选中后其子串不再计分，避免字典内容重复
+std::string train(const std::vector<std::string>& samples, const TrainerOptions& options) {
+    std::unordered_map<uint64_t, uint32_t> freq = countDmers(samples);
+
+    std::string data;
+    std::vector<size_t> sample_end;
+    for (const auto& s : samples) {
+        data += s;
+        sample_end.push_back(data.size());
+    }
+
+    size_t k = std::max(options.segment_size, kDmer);
+    size_t segments = std::max<size_t>(1, options.dict_size / k);
+    size_t epoch = std::max(k, data.size() / segments);
+
+    auto scoreOf = [&freq, &data](size_t pos) -> uint64_t {
+        auto it = freq.find(dmerHash(data.data() + pos));
+        return it == freq.end() ? 0 : it->second;
+    };
+
+    std::vector<Segment> selected;
+    size_t sample = 0;
+    for (size_t begin = 0; begin < data.size(); begin += epoch) {
+        size_t end = std::min(data.size(), begin + epoch);
+        Segment best = { 0, 0, 0 };
+
+        // 在每条消息内部滑动窗口，片段不跨消息
+        size_t pos = begin;
+        while (pos < end) {
+            while (sample_end[sample] <= pos) ++sample;
+            size_t limit = std::min(end, sample_end[sample]);
+            if (limit - pos >= k) {
+                uint64_t score = 0;
+                for (size_t i = pos; i + kDmer <= pos + k; ++i) score += scoreOf(i);
+                for (size_t start = pos; ; ++start) {
+                    if (score > best.score) {
+                        best.offset = start;
+                        best.length = k;
+                        best.score = score;
+                    }
+                    if (start + k >= limit) break;
+                    score -= scoreOf(start);
+                    score += scoreOf(start + k - kDmer + 1);
+                }
+            }
+            pos = limit;
+        }
+
+        if (best.score == 0) continue;
+        for (size_t i = best.offset; i + kDmer <= best.offset + best.length; ++i) {
+            freq.erase(dmerHash(data.data() + i));
+        }
+        selected.push_back(best);
+    }
+
+    // deflate优先匹配距离近的内容，得分高的片段放在字典末尾
+    std::sort(selected.begin(), selected.end(), [](const Segment& a, const Segment& b) { return a.score < b.score; });
+
+    std::string dictionary;
+    for (const auto& seg : selected) {
+        dictionary.append(data, seg.offset, seg.length);
+    }
+    if (dictionary.size() > options.dict_size) {
+        dictionary.erase(0, dictionary.size() - options.dict_size);
+    }
+    return dictionary;
+}
+
+#ifdef USE_ZLIB
+// 按no_context_takeover模式逐条压缩，比较有无字典的压缩后大小
+void evaluate(const std::vector<std::string>& samples, const std::string& dictionary) {
+    websocket::Compression plain(6, 15, 8, false);
+    websocket::Compression primed(6, 15, 8, false, dictionary);
+
+    size_t raw = 0, plain_size = 0, primed_size = 0;
+    size_t count = std::min<size_t>(samples.size(), 100000);
+    std::string out;
+    for (size_t i = 0; i < count; ++i) {
+        raw += samples[i].size();
+        if (plain.compress(samples[i], out)) plain_size += out.size();
+        if (primed.compress(samples[i], out)) primed_size += out.size();
+    }
+
+    std::cout << "样本消息数: " << count << std::endl;
+    std::cout << "原始大小: " << raw << " 字节" << std::endl;
+    std::cout << "无字典压缩: " << plain_size << " 字节 ("
+              << std::fixed << std::setprecision(1) << (raw ? 100.0 * plain_size / raw : 0) << "%)" << std::endl;
+    std::cout << "预置字典压缩: " << primed_size << " 字节 ("
+              << (raw ? 100.0 * primed_size / raw : 0) << "%)" << std::endl;
+}
+#endif
+
+void usage() {
+    std::cerr << "用法: websocket_dict_trainer [-s 字典大小] [-k 片段长度] [-o 输出文件] 样本文件..." << std::endl;
+    std::cerr << "  样本文件每行一条消息，字典默认4096字节，写入dictionary.bin" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    TrainerOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-s" || arg == "-k" || arg == "-o") && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (arg == "-s") options.dict_size = std::strtoul(value.c_str(), nullptr, 10);
+            else if (arg == "-k") options.segment_size = std::strtoul(value.c_str(), nullptr, 10);
+            else options.output = value;
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.inputs.empty() || options.dict_size == 0 || options.dict_size > 32768) {
+        usage();
+        return 1;
+    }
+
+    std::vector<std::string> samples;
+    if (!loadSamples(options.inputs, samples)) {
+        return 1;
+    }
+    if (samples.size() < 2) {
+        std::cerr << "样本太少，至少需要两条消息" << std::endl;
+        return 1;
+    }
+
+    std::string dictionary = train(samples, options);
+    std::ofstream out(options.output, std::ios::binary);
+    if (!out.write(dictionary.data(), dictionary.size())) {
+        std::cerr << "无法写入字典文件: " << options.output << std::endl;
+        return 1;
+    }
+    std::cout << "字典大小: " << dictionary.size() << " 字节，已写入 " << options.output << std::endl;
+
+    #ifdef USE_ZLIB
+    evaluate(samples, dictionary);
+    #endif
+    return 0;
+}
@@ -11,23 +11,22 @@ int main() {
     config.setCompressionLevel(6);
     config.setPingInterval(30000);
     config.addHeader("User-Agent", "WebSocket-Client/1.0");
-    config.addExtension("permessage-deflate", "client_max_window_bits=15");
 
     // 创建WebSocket客户端
     websocket::WebSocketClient client(config);
 
     // 设置消息回调
-    client.setMessageCallback([](const std::string& message) {
+    client.setOnMsgText([](const std::string& message) {
         std::cout << "Received message: " << message << std::endl;
     });
 
     // 设置错误回调
-    client.setErrorCallback([](const websocket::WebSocketError& error) {
-        std::cout << "Error: " << error.toString() << std::endl;
+    client.setOnError([](const std::string& error) {
+        std::cout << "Error: " << error << std::endl;
     });
 
     // 设置状态变化回调
-    client.setStateChangeCallback([](websocket::WebSocketState state) {
+    client.setOnStateChange([](websocket::WebSocketState state) {
         std::string state_str;
         switch (state) {
             case websocket::WebSocketState::CONNECTING:
@@ -50,7 +49,7 @@ int main() {
     std::cout << "Connecting to WebSocket server..." << std::endl;
     
     // 使用一个公共的WebSocket echo服务器进行测试
-    if (client.connect("wss://echo.websocket.org")) {
+    if (client.connect_sync("wss://echo.websocket.org")) {
         std::cout << "Connected successfully!" << std::endl;
 
         // 发送文本消息
@@ -0,0 +1,44 @@
+#ifndef WEBSOCKET_FUZZ_COMMON_HPP
+#define WEBSOCKET_FUZZ_COMMON_HPP
+
+// 各fuzz目标共用的检查宏和辅助函数
+#include "websocket_client.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// 不变量不成立时打印位置并abort，libFuzzer会保存触发的输入
+#define FUZZ_CHECK(cond)                                                              \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            fprintf(stderr, "%s:%d: FUZZ_CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                                  \
+        }                                                                             \
+    } while (0)
+
+namespace fuzz {
+
+inline bool sameFrame(const websocket::WebSocketFrame& a, const websocket::WebSocketFrame& b) {
+    return a.isFin() == b.isFin() && a.getRsv() == b.getRsv() && a.getOpcode() == b.getOpcode() && a.isMasked() == b.isMasked() &&
+           a.getPayload() == b.getPayload() && a.getPayloadLength() == b.getPayloadLength();
+}
+
+// 由输入决定的伪随机数，用于切分读取长度等
+class InputRandom {
+public:
+    explicit InputRandom(uint64_t seed) : state_(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    uint32_t next(uint32_t bound) {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return bound ? static_cast<uint32_t>(state_ % bound) : 0;
+    }
+
+private:
+    uint64_t state_;
+};
+
+} // namespace fuzz
+
+#endif // WEBSOCKET_FUZZ_COMMON_HPP
@@ -0,0 +1,37 @@
+// WebSocketFrame::parse：从任意字节流连续解析帧，检查consumed与frameSize一致、载荷长度与头部一致
+#include "fuzz_common.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    const char* p = reinterpret_cast<const char*>(data);
+    websocket::WebSocketFrame frame;
+
+    size_t offset = 0;
+    while (offset < size) {
+        size_t remaining = size - offset;
+        uint64_t payload_length = 0;
+        size_t frame_size = websocket::WebSocketFrame::frameSize(p + offset, remaining, payload_length);
+
+        size_t consumed = 0;
+        if (!websocket::WebSocketFrame::parse(p + offset, remaining, frame, consumed)) {
+            break;
+        }
+        if (consumed == 0) {
+            // 数据不足一帧
+            FUZZ_CHECK(frame_size == 0 || frame_size > remaining);
+            break;
+        }
+
+        FUZZ_CHECK(consumed == frame_size);
+        FUZZ_CHECK(consumed <= remaining);
+        FUZZ_CHECK(frame.getPayloadLength() == payload_length);
+        FUZZ_CHECK(frame.getPayload().size() == payload_length);
+        FUZZ_CHECK(frame.getOpcode() == (data[offset] & 0x0F));
+        FUZZ_CHECK(frame.isFin() == ((data[offset] & 0x80) != 0));
+        offset += consumed;
+    }
+
+    // 整段输入只解析一帧的接口
+    websocket::WebSocketFrame single;
+    websocket::WebSocketFrame::parse(std::string(p, size), single);
+    return 0;
+}
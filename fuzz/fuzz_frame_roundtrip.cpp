@@ -0,0 +1,64 @@
+// 差分测试serialize与parse：
+// 1. 由输入构造帧，serialize后parse必须得到相同的帧，且正好消费全部字节
+// 2. 从输入解析出的帧重新serialize再parse结果不变；输入使用最短长度编码时，重新编码的字节与输入相同
+#include "fuzz_common.hpp"
+#include <cstring>
+
+namespace {
+
+// 载荷长度是否使用了最短编码
+bool minimalLength(const uint8_t* data, uint64_t payload_length) {
+    uint8_t length_code = data[1] & 0x7F;
+    if (length_code == 126) return payload_length >= 126;
+    if (length_code == 127) return payload_length >= 65536;
+    return true;
+}
+
+void roundTripConstructed(const uint8_t* data, size_t size) {
+    if (size < 5) return;
+
+    websocket::WebSocketFrame frame;
+    frame.setFin((data[0] & 0x80) != 0);
+    frame.setRsv(static_cast<uint8_t>(data[0] >> 4));
+    frame.setOpcode(data[0] & 0x0F);
+    frame.setMasked((data[0] & 0x40) != 0);
+    if (frame.isMasked()) {
+        frame.setMaskKey(std::string(reinterpret_cast<const char*>(data + 1), 4));
+    }
+    frame.setPayload(std::string(reinterpret_cast<const char*>(data + 5), size - 5));
+
+    std::string wire = frame.serialize();
+    websocket::WebSocketFrame parsed;
+    size_t consumed = 0;
+    FUZZ_CHECK(websocket::WebSocketFrame::parse(wire.data(), wire.size(), parsed, consumed));
+    FUZZ_CHECK(consumed == wire.size());
+    FUZZ_CHECK(fuzz::sameFrame(frame, parsed));
+}
+
+void roundTripParsed(const uint8_t* data, size_t size) {
+    websocket::WebSocketFrame frame;
+    size_t consumed = 0;
+    if (!websocket::WebSocketFrame::parse(reinterpret_cast<const char*>(data), size, frame, consumed) || consumed == 0) {
+        return;
+    }
+
+    std::string wire = frame.serialize();
+    websocket::WebSocketFrame reparsed;
+    size_t reconsumed = 0;
+    FUZZ_CHECK(websocket::WebSocketFrame::parse(wire.data(), wire.size(), reparsed, reconsumed));
+    FUZZ_CHECK(reconsumed == wire.size());
+    FUZZ_CHECK(fuzz::sameFrame(frame, reparsed));
+
+    if (minimalLength(data, frame.getPayloadLength())) {
+        FUZZ_CHECK(wire.size() == consumed);
+        FUZZ_CHECK(memcmp(wire.data(), data, consumed) == 0);
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    roundTripConstructed(data, size);
+    roundTripParsed(data, size);
+    return 0;
+}
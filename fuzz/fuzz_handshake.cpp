@@ -0,0 +1,62 @@
+// 握手响应：按连接时的方式分多次扫描响应头结尾，结果必须与一次扫描相同，
+// 然后解析响应头、查找permessage-deflate参数并按两种压缩配置协商
+#include "fuzz_common.hpp"
+
+namespace {
+
+// RFC 6455示例中密钥"dGhlIHNhbXBsZSBub25jZQ=="对应的Accept值，种子语料使用同一个值
+const char kAcceptKey[] = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 1) return 0;
+
+    fuzz::InputRandom random(data[0]);
+    const char* response = reinterpret_cast<const char*>(data + 1);
+    size_t response_size = size - 1;
+
+    size_t header_length = websocket::WebSocketHandshake::findHeaderEnd(response, response_size, 0);
+    FUZZ_CHECK(header_length <= response_size);
+
+    // 每次多收到一段数据，从上次已扫描的长度继续
+    size_t received = 0;
+    size_t incremental = 0;
+    while (incremental == 0 && received < response_size) {
+        size_t scanned = received;
+        received = std::min(response_size, received + 1 + random.next(64));
+        incremental = websocket::WebSocketHandshake::findHeaderEnd(response, received, scanned);
+    }
+    FUZZ_CHECK(incremental == header_length);
+
+    std::string extensions;
+    size_t parse_length = header_length ? header_length : response_size;
+    websocket::WebSocketResult res = websocket::WebSocketHandshake::parseHandshakeResponse(
+        response, parse_length, kAcceptKey, &extensions);
+    if (res) {
+        std::string value;
+        websocket::WebSocketHandshake::findExtensionParam(extensions, "permessage-deflate", "server_max_window_bits", value);
+        websocket::WebSocketHandshake::findExtensionParam(extensions, "permessage-deflate", "server_no_context_takeover", value);
+        websocket::WebSocketHandshake::findExtensionParam(extensions, "permessage-deflate", "dictionary_id", value);
+
+        websocket::WebSocketConfig config;
+        config.enableCompression(true);
+        if (random.next(2)) {
+            config.setCompressionWindowBits(9 + static_cast<int>(random.next(7)));
+            config.setCompressionContextTakeover(false);
+            config.setCompressionDictionary("fuzz", "dictionary");
+        }
+        websocket::DeflateParams offer = websocket::WebSocketHandshake::offeredDeflateParams(config);
+        websocket::DeflateParams params;
+        bool active = false;
+        bool dictionary = false;
+        if (websocket::WebSocketHandshake::negotiateDeflate(extensions, config, params, active, dictionary) && active) {
+            // 接受的参数不能超出提议
+            FUZZ_CHECK(params.client_max_window_bits >= 9 && params.client_max_window_bits <= offer.client_max_window_bits);
+            FUZZ_CHECK(params.server_max_window_bits >= 8 && params.server_max_window_bits <= offer.server_max_window_bits);
+            FUZZ_CHECK(!offer.server_no_context_takeover || params.server_no_context_takeover);
+            FUZZ_CHECK(!offer.client_no_context_takeover || params.client_no_context_takeover);
+        }
+    }
+    return 0;
+}
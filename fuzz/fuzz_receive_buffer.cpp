@@ -0,0 +1,77 @@
+// 增量接收路径：按receiveFrame的方式把输入分成长短不一的多次读取写入ReceiveBuffer，
+// 解析出的帧序列必须与一次性解析整段输入的结果相同
+#include "fuzz_common.hpp"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const uint64_t kMaxFrameSize = 1024 * 1024;   // 对应WebSocketConfig::getMaxFrameSize，超过时停止接收
+
+// 一次性解析整段输入
+std::vector<websocket::WebSocketFrame> parseContiguous(const char* data, size_t size) {
+    std::vector<websocket::WebSocketFrame> frames;
+    size_t offset = 0;
+    while (offset < size) {
+        uint64_t payload_length = 0;
+        size_t frame_size = websocket::WebSocketFrame::frameSize(data + offset, size - offset, payload_length);
+        if (frame_size == 0 || payload_length > kMaxFrameSize || frame_size > size - offset) break;
+
+        websocket::WebSocketFrame frame;
+        size_t consumed = 0;
+        if (!websocket::WebSocketFrame::parse(data + offset, frame_size, frame, consumed) || consumed == 0) break;
+        frames.push_back(frame);
+        offset += consumed;
+    }
+    return frames;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 1) return 0;
+
+    // 第一个字节决定每次读取的长度
+    fuzz::InputRandom random(data[0]);
+    const char* input = reinterpret_cast<const char*>(data + 1);
+    size_t input_size = size - 1;
+
+    websocket::ReceiveBuffer buffer;
+    std::vector<websocket::WebSocketFrame> frames;
+    size_t fed = 0;
+    while (true) {
+        uint64_t payload_length = 0;
+        size_t frame_size = websocket::WebSocketFrame::frameSize(buffer.data(), buffer.size(), payload_length);
+        if (frame_size != 0 && payload_length > kMaxFrameSize) break;
+
+        if (frame_size == 0 || buffer.size() < frame_size) {
+            if (fed == input_size) break;
+
+            size_t missing = frame_size > buffer.size() ? frame_size - buffer.size() : 0;
+            char* dst = buffer.prepare(missing);
+            FUZZ_CHECK(buffer.writable() >= missing);
+            FUZZ_CHECK(dst == buffer.data() + buffer.size());
+
+            size_t chunk = 1 + random.next(random.next(2) ? 16 : 4096);
+            chunk = std::min(chunk, std::min(buffer.writable(), input_size - fed));
+            memcpy(dst, input + fed, chunk);
+            buffer.commit(chunk);
+            fed += chunk;
+            continue;
+        }
+
+        websocket::WebSocketFrame frame;
+        size_t consumed = 0;
+        if (!websocket::WebSocketFrame::parse(buffer.data(), frame_size, frame, consumed)) break;
+        FUZZ_CHECK(consumed == frame_size);
+        buffer.consume(consumed);
+        frames.push_back(frame);
+    }
+
+    std::vector<websocket::WebSocketFrame> expected = parseContiguous(input, input_size);
+    FUZZ_CHECK(frames.size() == expected.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        FUZZ_CHECK(fuzz::sameFrame(frames[i], expected[i]));
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+// URL::parse：任意输入不能抛异常或崩溃，解析成功时主机、端口、路径合法；
+// 输入按第一个换行分成两个URL，复用同一个对象解析第二个，结果必须与新对象相同
+#include "fuzz_common.hpp"
+
+namespace {
+
+bool sameUrl(const websocket::URL& a, const websocket::URL& b) {
+    return a.scheme() == b.scheme() && a.host() == b.host() && a.port() == b.port() &&
+           a.path() == b.path() && a.query() == b.query();
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string input(reinterpret_cast<const char*>(data), size);
+    size_t newline = input.find('\n');
+    std::string first = input.substr(0, newline);
+    std::string second = newline == std::string::npos ? std::string() : input.substr(newline + 1);
+
+    websocket::URL url;
+    if (url.parse(first)) {
+        FUZZ_CHECK(!url.host().empty());
+        FUZZ_CHECK(url.port() > 0 && url.port() <= 65535);
+        FUZZ_CHECK(!url.path().empty() && url.path()[0] == '/');
+    }
+
+    websocket::URL fresh;
+    websocket::WebSocketResult fresh_res = fresh.parse(second);
+    websocket::WebSocketResult reused_res = url.parse(second);
+    FUZZ_CHECK(static_cast<bool>(fresh_res) == static_cast<bool>(reused_res));
+    if (fresh_res) {
+        FUZZ_CHECK(sameUrl(url, fresh));
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+// 没有libFuzzer的编译器(GCC、MSVC)使用的入口：依次把参数中的文件或目录下的文件交给
+// LLVMFuzzerTestOneInput，用于回放语料和崩溃样本；以'-'开头的参数(libFuzzer选项)忽略
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+void collect(const std::string& path, std::vector<std::string>& files) {
+#ifndef _WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path.c_str());
+        if (dir == nullptr) return;
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            collect(path + "/" + name, files);
+        }
+        closedir(dir);
+        return;
+    }
+#endif
+    files.push_back(path);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-') continue;
+        collect(argv[i], files);
+    }
+
+    for (const auto& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            std::cerr << "无法打开: " << file << std::endl;
+            return 1;
+        }
+        std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+    std::cout << "已执行 " << files.size() << " 个输入" << std::endl;
+    return 0;
+}
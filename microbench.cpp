@@ -0,0 +1,190 @@
+// 编解码基础操作的微基准(Google Benchmark)：每个热点操作单独给出数字，便于发现性能回退
+//
+// 用法: websocket_microbench [--benchmark_filter=正则] [--benchmark_format=json] ...
+// 只在找到Google Benchmark时构建
+#include "websocket_client.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <random>
+#include <string>
+#include <vector>
+#include <thread>
+
+namespace {
+
+const size_t kMessageCount = 64;   // 压缩基准轮流使用的消息数
+
+// 字段相同、取值随机的JSON消息，接近行情推送的数据
+std::vector<std::string> makeMessages(size_t size) {
+    std::mt19937 rng(42);
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < kMessageCount; ++i) {
+        std::string message = "{\"type\":\"trade\",\"seq\":" + std::to_string(i) +
+                              ",\"price\":\"" + std::to_string(rng() % 100000) +
+                              "\",\"qty\":\"" + std::to_string(rng() % 1000) + "\",\"data\":\"";
+        while (message.size() + 2 < size) {
+            message.push_back(static_cast<char>('a' + rng() % 26));
+        }
+        message += "\"}";
+        messages.push_back(message);
+    }
+    return messages;
+}
+
+std::string makePayload(size_t size) {
+    std::string payload(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        payload[i] = static_cast<char>(i * 131 + 7);
+    }
+    return payload;
+}
+
+// 握手密钥：16字节随机数的base64，以及接收方计算Accept时的输入
+void BM_Base64Encode(benchmark::State& state) {
+    std::string input = makePayload(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(websocket::Utils::base64Encode(input));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Base64Encode)->Arg(16)->Arg(20)->Arg(1024);
+
+void BM_Sha1(benchmark::State& state) {
+    std::string input = makePayload(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(websocket::Utils::sha1(input));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Sha1)->Arg(60)->Arg(1024);
+
+void BM_GenerateRandomString(benchmark::State& state) {
+    size_t length = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(websocket::Utils::generateRandomString(length));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_GenerateRandomString)->Arg(16)->Arg(64);
+
+void BM_GenerateMaskKey(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(websocket::Utils::generateMaskKey());
+    }
+}
+BENCHMARK(BM_GenerateMaskKey);
+
+// 参数: 载荷大小, 是否加掩码(客户端发送的帧都带掩码)
+void BM_FrameSerialize(benchmark::State& state) {
+    websocket::WebSocketFrame frame;
+    frame.setOpcode(static_cast<uint8_t>(websocket::FrameType::BINARY));
+    frame.setPayload(makePayload(static_cast<size_t>(state.range(0))));
+    frame.setMasked(state.range(1) != 0);
+    if (state.range(1)) {
+        frame.setMaskKey(websocket::Utils::generateMaskKey());
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(frame.serialize());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_FrameSerialize)->ArgsProduct({{16, 125, 1024, 65536, 1 << 20}, {0, 1}});
+
+void BM_FrameParse(benchmark::State& state) {
+    websocket::WebSocketFrame source;
+    source.setOpcode(static_cast<uint8_t>(websocket::FrameType::BINARY));
+    source.setPayload(makePayload(static_cast<size_t>(state.range(0))));
+    source.setMasked(state.range(1) != 0);
+    if (state.range(1)) {
+        source.setMaskKey(websocket::Utils::generateMaskKey());
+    }
+    std::string wire = source.serialize();
+
+    websocket::WebSocketFrame frame;
+    for (auto _ : state) {
+        size_t consumed = 0;
+        websocket::WebSocketResult res = websocket::WebSocketFrame::parse(wire.data(), wire.size(), frame, consumed);
+        if (!res || consumed != wire.size()) {
+            state.SkipWithError("parse failed");
+            break;
+        }
+        benchmark::DoNotOptimize(frame.getPayload().data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_FrameParse)->ArgsProduct({{16, 125, 1024, 65536, 1 << 20}, {0, 1}});
+
+#ifdef USE_ZLIB
+// 参数: 消息大小, 是否上下文接管；轮流压缩kMessageCount条不同的消息
+void BM_Compress(benchmark::State& state) {
+    std::vector<std::string> messages = makeMessages(static_cast<size_t>(state.range(0)));
+    websocket::Compression compression(6, 15, 8, state.range(1) != 0);
+    std::string out;
+    size_t index = 0;
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        const std::string& message = messages[index++ % kMessageCount];
+        if (!compression.compress(message, out)) {
+            state.SkipWithError("compress failed");
+            break;
+        }
+        bytes += static_cast<int64_t>(message.size());
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_Compress)->ArgsProduct({{128, 1024, 16384}, {0, 1}});
+
+// 上下文接管时压缩结果依赖前面的消息，所以每次迭代从新的上下文开始解压整批消息
+void BM_Decompress(benchmark::State& state) {
+    std::vector<std::string> messages = makeMessages(static_cast<size_t>(state.range(0)));
+    bool takeover = state.range(1) != 0;
+
+    websocket::Compression compressor(6, 15, 8, takeover);
+    std::vector<std::string> compressed(kMessageCount);
+    int64_t batch_bytes = 0;
+    for (size_t i = 0; i < kMessageCount; ++i) {
+        compressor.compress(messages[i], compressed[i]);
+        batch_bytes += static_cast<int64_t>(messages[i].size());
+    }
+
+    websocket::Compression decompressor(6, 15, 8, takeover);
+    std::string out;
+    for (auto _ : state) {
+        decompressor.reset();
+        for (size_t i = 0; i < kMessageCount; ++i) {
+            if (!decompressor.decompress(compressed[i], out)) {
+                state.SkipWithError("decompress failed");
+                return;
+            }
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kMessageCount));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * batch_bytes);
+}
+BENCHMARK(BM_Decompress)->ArgsProduct({{128, 1024, 16384}, {0, 1}});
+#endif
+
+// 多个线程向同一个TaskRunner投递，计时包括等待本线程投递的任务全部执行完
+void BM_TaskRunnerPushTask(benchmark::State& state) {
+    static websocket::TaskRunner runner;
+    if (state.thread_index() == 0) {
+        runner.start();
+    }
+
+    std::atomic<int64_t> executed(0);
+    int64_t pushed = 0;
+    for (auto _ : state) {
+        runner.push_task([&executed] { executed.fetch_add(1, std::memory_order_relaxed); });
+        ++pushed;
+    }
+    while (executed.load(std::memory_order_acquire) < pushed) {
+        std::this_thread::yield();
+    }
+    state.SetItemsProcessed(pushed);
+}
+BENCHMARK(BM_TaskRunnerPushTask)->ThreadRange(1, 4)->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -20,16 +20,16 @@ public:
         
         websocket::WebSocketClient client;
         
-        client.setMessageCallback([this](const std::string& message) {
+        client.setOnMsgText([this](const std::string&) {
             messages_received_++;
         });
         
-        client.setErrorCallback([this](const websocket::WebSocketError& error) {
+        client.setOnError([this](const std::string& error) {
             errors_++;
-            std::cout << "错误: " << error.toString() << std::endl;
+            std::cout << "错误: " << error << std::endl;
         });
         
-        if (client.connect("wss://echo.websocket.org")) {
+        if (client.connect_sync("wss://echo.websocket.org")) {
             std::cout << "连接成功，开始延迟测试..." << std::endl;
             
             start_time_ = std::chrono::high_resolution_clock::now();
@@ -66,15 +66,15 @@ public:
         
         websocket::WebSocketClient client;
         
-        client.setMessageCallback([this](const std::string& message) {
+        client.setOnMsgText([this](const std::string&) {
             messages_received_++;
         });
         
-        client.setErrorCallback([this](const websocket::WebSocketError& error) {
+        client.setOnError([this](const std::string&) {
             errors_++;
         });
         
-        if (client.connect("wss://echo.websocket.org")) {
+        if (client.connect_sync("wss://echo.websocket.org")) {
             std::cout << "连接成功，开始吞吐量测试..." << std::endl;
             
             start_time_ = std::chrono::high_resolution_clock::now();
@@ -124,15 +124,15 @@ public:
         
         websocket::WebSocketClient client(config);
         
-        client.setMessageCallback([this](const std::string& message) {
+        client.setOnMsgText([this](const std::string&) {
             messages_received_++;
         });
         
-        client.setErrorCallback([this](const websocket::WebSocketError& error) {
+        client.setOnError([this](const std::string&) {
             errors_++;
         });
         
-        if (client.connect("wss://echo.websocket.org")) {
+        if (client.connect_sync("wss://echo.websocket.org")) {
             start_time_ = std::chrono::high_resolution_clock::now();
             
             // 发送大量数据
@@ -168,13 +168,13 @@ public:
         std::cout << "创建多个WebSocket客户端..." << std::endl;
         
         for (int i = 0; i < 10; ++i) {
-            auto client = std::make_unique<websocket::WebSocketClient>();
+            auto client = std::unique_ptr<websocket::WebSocketClient>(new websocket::WebSocketClient());
             
-            client->setMessageCallback([](const std::string& message) {
+            client->setOnMsgText([](const std::string&) {
                 // 空回调
             });
             
-            client->setErrorCallback([](const websocket::WebSocketError& error) {
+            client->setOnError([](const std::string&) {
                 // 空回调
             });
             
@@ -185,7 +185,7 @@ public:
         
         // 连接所有客户端
         for (auto& client : clients) {
-            client->connect("wss://echo.websocket.org");
+            client->connect_sync("wss://echo.websocket.org");
         }
         
         std::this_thread::sleep_for(std::chrono::seconds(2));
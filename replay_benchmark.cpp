@@ -0,0 +1,317 @@
+// 回放驱动的吞吐基准：不使用socket，在内存中分阶段测量帧解析、解掩码、解压和回调投递的开销，
+// 排除网络抖动，只看库本身的开销
+//
+// 用法: websocket_replay_benchmark [选项] <录制前缀>        使用录制的入站帧
+//       websocket_replay_benchmark [选项] --synthetic       使用生成的JSON消息
+// 选项: -n 消息数(合成，默认200000)  -s 平均大小(合成，默认256)  -r 每阶段轮数(默认5，取最好一轮)
+//       --compressed 载荷为permessage-deflate压缩数据(合成时先压缩)  --no-context-takeover
+#include "websocket_client.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace {
+
+struct BenchmarkOptions {
+    std::string prefix;
+    bool synthetic = false;
+    size_t messages = 200000;
+    size_t average_size = 256;
+    int rounds = 5;
+    bool compressed = false;
+    bool context_takeover = true;
+};
+
+// 入站帧，载荷与录制时相同(压缩时为压缩后的数据)
+struct Workload {
+    std::vector<websocket::WebSocketFrame> frames;
+    size_t payload_bytes = 0;
+};
+
+struct StageResult {
+    std::string name;
+    size_t frames = 0;
+    size_t bytes = 0;
+    int64_t ns = 0;
+};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void report(const StageResult& result) {
+    double ns_per_frame = result.frames ? static_cast<double>(result.ns) / result.frames : 0;
+    double gbps = result.ns ? static_cast<double>(result.bytes) / result.ns : 0;
+    std::cout << std::left << std::setw(14) << result.name << std::right
+              << std::setw(10) << result.frames << " 帧"
+              << std::setw(12) << std::fixed << std::setprecision(1) << ns_per_frame << " ns/帧"
+              << std::setw(10) << std::setprecision(3) << gbps << " GB/s" << std::endl;
+}
+
+// 多轮中取最快的一轮
+template <typename Stage>
+StageResult runStage(const std::string& name, int rounds, Stage stage) {
+    StageResult best;
+    best.name = name;
+    for (int i = 0; i < rounds; ++i) {
+        StageResult result;
+        int64_t start = nowNs();
+        stage(result);
+        result.ns = nowNs() - start;
+        if (i == 0 || result.ns < best.ns) {
+            best.frames = result.frames;
+            best.bytes = result.bytes;
+            best.ns = result.ns;
+        }
+    }
+    return best;
+}
+
+bool loadRecording(const std::string& prefix, Workload& workload) {
+    websocket::TrafficReplayer replayer;
+    websocket::WebSocketResult res = replayer.open(prefix);
+    if (!res) {
+        std::cerr << "无法打开录制: " << res.message() << std::endl;
+        return false;
+    }
+
+    websocket::RecordedFrame recorded;
+    while (replayer.next(recorded)) {
+        if (recorded.direction != websocket::TrafficDirection::INBOUND) continue;
+        websocket::WebSocketFrame frame;
+        frame.setFin(recorded.fin);
+        frame.setOpcode(recorded.opcode);
+        frame.setRsv(recorded.rsv);
+        frame.setPayload(std::string(recorded.data, recorded.length));
+        workload.payload_bytes += recorded.length;
+        workload.frames.push_back(frame);
+    }
+    return true;
+}
+
+// 生成字段相同、取值随机的JSON消息，大小在平均值上下浮动
+void generateSynthetic(const BenchmarkOptions& options, Workload& workload) {
+    std::mt19937 rng(42);
+    #ifdef USE_ZLIB
+    websocket::Compression compression(6, 15, 8, options.context_takeover);
+    #endif
+
+    for (size_t i = 0; i < options.messages; ++i) {
+        std::string message = "{\"type\":\"trade\",\"seq\":" + std::to_string(i) +
+                              ",\"price\":\"" + std::to_string(rng() % 100000) + "." + std::to_string(rng() % 100) +
+                              "\",\"qty\":\"" + std::to_string(rng() % 1000) + "\",\"data\":\"";
+        size_t target = options.average_size / 2 + rng() % (options.average_size + 1);
+        while (message.size() + 2 < target) {
+            message.push_back(static_cast<char>('a' + rng() % 26));
+        }
+        message += "\"}";
+
+        #ifdef USE_ZLIB
+        if (options.compressed) {
+            std::string compressed;
+            compression.compress(message, compressed);
+            message.swap(compressed);
+        }
+        #endif
+
+        websocket::WebSocketFrame frame;
+        frame.setOpcode(static_cast<uint8_t>(websocket::FrameType::TEXT));
+        frame.setRsv1(options.compressed);
+        frame.setPayload(message);
+        workload.payload_bytes += message.size();
+        workload.frames.push_back(frame);
+    }
+}
+
+// 按服务端发送的格式拼成连续的字节流，masked为true时加掩码，用于测量解掩码开销
+std::string buildWire(const Workload& workload, bool masked) {
+    std::string wire;
+    wire.reserve(workload.payload_bytes + workload.frames.size() * 14);
+    for (const auto& source : workload.frames) {
+        websocket::WebSocketFrame frame = source;
+        frame.setMasked(masked);
+        if (masked) {
+            frame.setMaskKey(websocket::Utils::generateMaskKey());
+        }
+        wire += frame.serialize();
+    }
+    return wire;
+}
+
+StageResult parseStage(const std::string& name, const std::string& wire, int rounds) {
+    return runStage(name, rounds, [&wire](StageResult& result) {
+        websocket::WebSocketFrame frame;
+        size_t offset = 0;
+        while (offset < wire.size()) {
+            size_t consumed = 0;
+            if (!websocket::WebSocketFrame::parse(wire.data() + offset, wire.size() - offset, frame, consumed) || consumed == 0) {
+                std::cerr << "解析失败，偏移 " << offset << std::endl;
+                break;
+            }
+            offset += consumed;
+            result.frames++;
+        }
+        result.bytes = offset;
+    });
+}
+
+#ifdef USE_ZLIB
+// 按帧解压，统计解压后的字节数；上下文接管时每轮使用新的上下文
+StageResult decompressStage(const Workload& workload, const BenchmarkOptions& options) {
+    return runStage("decompress", options.rounds, [&workload, &options](StageResult& result) {
+        websocket::Compression compression(6, 15, 8, options.context_takeover);
+        std::string out;
+        for (const auto& frame : workload.frames) {
+            // 只有带RSV1的数据消息第一帧是压缩的
+            if (!frame.isRsv1()) {
+                continue;
+            }
+            if (!compression.decompress(frame.getPayload(), out)) {
+                std::cerr << "解压失败" << std::endl;
+                break;
+            }
+            result.frames++;
+            result.bytes += out.size();
+        }
+    });
+}
+#endif
+
+// 经过WebSocketClient::replay的完整接收路径: handleFrame、解压、UTF-8校验、投递线程和回调
+StageResult dispatchStage(const std::string& prefix, const Workload& workload, const BenchmarkOptions& options) {
+    websocket::WebSocketConfig config;
+    #ifdef USE_ZLIB
+    config.enableCompression(options.compressed);
+    config.setCompressionContextTakeover(options.context_takeover);
+    #endif
+    config.setReceiveWatermarks(0, 0);
+
+    return runStage("dispatch", options.rounds, [&](StageResult& result) {
+        std::atomic<size_t> delivered(0);
+        std::atomic<size_t> bytes(0);
+        websocket::WebSocketClient client(config);
+        client.setOnMsgText([&](const std::string& message) {
+            delivered++;
+            bytes += message.size();
+        });
+        client.setOnMsgBinary([&](const std::vector<uint8_t>& message) {
+            delivered++;
+            bytes += message.size();
+        });
+
+        websocket::WebSocketResult res = client.replay(prefix, websocket::ReplayPace::MAX_SPEED);
+        if (!res) {
+            std::cerr << "回放失败: " << res.message() << std::endl;
+        }
+        result.frames = workload.frames.size();
+        result.bytes = bytes;
+    });
+}
+
+// 合成数据需要先写成录制文件，才能走replay路径
+std::string writeRecording(const Workload& workload) {
+    std::string prefix = "/tmp/websocket_replay_benchmark." + std::to_string(getpid());
+    websocket::TrafficRecorder recorder;
+    if (!recorder.open(prefix)) {
+        return std::string();
+    }
+    for (const auto& frame : workload.frames) {
+        const std::string& payload = frame.getPayload();
+        recorder.record(websocket::TrafficDirection::INBOUND, frame.getOpcode(), frame.isFin(), frame.getRsv(), payload.data(), payload.size());
+    }
+    recorder.close();
+    return prefix;
+}
+
+void removeRecording(const std::string& prefix) {
+    for (size_t index = 0; ; ++index) {
+        if (unlink(websocket::TrafficFormat::segmentPath(prefix, index).c_str()) != 0) break;
+    }
+}
+
+void usage() {
+    std::cerr << "用法: websocket_replay_benchmark [-n 消息数] [-s 平均大小] [-r 轮数] [--compressed] "
+                 "[--no-context-takeover] (<录制前缀> | --synthetic)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-n" || arg == "-s" || arg == "-r") && i + 1 < argc) {
+            unsigned long value = std::strtoul(argv[++i], nullptr, 10);
+            if (arg == "-n") options.messages = value;
+            else if (arg == "-s") options.average_size = value;
+            else options.rounds = static_cast<int>(value);
+        } else if (arg == "--synthetic") {
+            options.synthetic = true;
+        } else if (arg == "--compressed") {
+            options.compressed = true;
+        } else if (arg == "--no-context-takeover") {
+            options.context_takeover = false;
+        } else if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else {
+            options.prefix = arg;
+        }
+    }
+
+    if (options.synthetic == !options.prefix.empty() || options.rounds <= 0) {
+        usage();
+        return 1;
+    }
+
+    #ifndef USE_ZLIB
+    if (options.compressed) {
+        std::cerr << "未启用zlib，无法测试压缩数据" << std::endl;
+        return 1;
+    }
+    #endif
+
+    Workload workload;
+    if (options.synthetic) {
+        generateSynthetic(options, workload);
+    } else if (!loadRecording(options.prefix, workload)) {
+        return 1;
+    }
+    if (workload.frames.empty()) {
+        std::cerr << "没有入站帧" << std::endl;
+        return 1;
+    }
+
+    std::cout << "=== 回放吞吐基准 ===" << std::endl;
+    std::cout << "入站帧: " << workload.frames.size() << "，载荷: " << workload.payload_bytes << " 字节"
+              << (options.compressed ? " (压缩)" : "") << std::endl;
+
+    std::string wire = buildWire(workload, false);
+    std::string masked_wire = buildWire(workload, true);
+    report(parseStage("parse", wire, options.rounds));
+    report(parseStage("parse+unmask", masked_wire, options.rounds));
+
+    #ifdef USE_ZLIB
+    if (options.compressed) {
+        report(decompressStage(workload, options));
+    }
+    #endif
+
+    std::string prefix = options.synthetic ? writeRecording(workload) : options.prefix;
+    if (prefix.empty()) {
+        std::cerr << "无法写入临时录制文件" << std::endl;
+        return 1;
+    }
+    report(dispatchStage(prefix, workload, options));
+    if (options.synthetic) {
+        removeRecording(prefix);
+    }
+    return 0;
+}
@@ -0,0 +1,638 @@
+// 多连接扩展性基准：在本进程内启动若干本地回显服务端，逐级增加客户端连接数(默认1k/10k/50k)，
+// 每一级测量建连速率、每连接内存和线程数、总吞吐以及p50/p99延迟
+//
+// 用法: websocket_scale_benchmark [-c 1000,10000,50000] [-S 服务端数] [-j 建连线程数]
+//                                 [-t 发送线程数] [-d 每级秒数] [-s 消息大小]
+// 仅支持Linux(服务端使用epoll)
+#include "websocket_client.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <openssl/sha.h>
+
+namespace {
+
+struct ScaleOptions {
+    std::vector<size_t> levels = { 1000, 10000, 50000 };
+    size_t servers = 4;              // 本地服务端数，分散到多个端口避免单个目的端口耗尽临时端口
+    size_t connect_threads = 16;
+    size_t driver_threads = 4;
+    int seconds = 5;                 // 每一级的收发测量时长
+    size_t message_size = 64;
+};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 从/proc/self/status读取字段(kB或个数)
+long readStatus(const char* field) {
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    size_t field_len = strlen(field);
+    while (std::getline(in, line)) {
+        if (line.compare(0, field_len, field) == 0 && line.size() > field_len && line[field_len] == ':') {
+            return std::strtol(line.c_str() + field_len + 1, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+// 对数分桶的延迟直方图，每个2的幂区间再分16档，多线程无锁记录
+class LatencyHistogram {
+public:
+    LatencyHistogram() {
+        for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+    }
+
+    void record(int64_t ns) {
+        uint64_t value = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+        buckets_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void clear() {
+        for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+    }
+
+    // 返回该分位所在桶的下界(纳秒)
+    uint64_t percentile(double p) const {
+        uint64_t total = 0;
+        for (const auto& bucket : buckets_) total += bucket.load(std::memory_order_relaxed);
+        if (total == 0) return 0;
+
+        uint64_t rank = static_cast<uint64_t>(p * (total - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen > rank) return lowerBound(i);
+        }
+        return lowerBound(kBuckets - 1);
+    }
+
+private:
+    static const size_t kSubBuckets = 16;
+    static const size_t kBuckets = 64 * kSubBuckets;
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < kSubBuckets) return static_cast<size_t>(value);
+        size_t msb = 63 - static_cast<size_t>(__builtin_clzll(value));
+        size_t sub = static_cast<size_t>(value >> (msb - 4)) & (kSubBuckets - 1);
+        return (msb - 3) * kSubBuckets + sub;
+    }
+
+    static uint64_t lowerBound(size_t index) {
+        if (index < kSubBuckets) return index;
+        size_t msb = index / kSubBuckets + 3;
+        return (static_cast<uint64_t>(kSubBuckets + index % kSubBuckets)) << (msb - 4);
+    }
+
+    std::atomic<uint64_t> buckets_[kBuckets];
+};
+
+// 最简单的WebSocket回显服务端：单线程epoll，完成握手后把收到的数据帧原样(不加掩码)发回
+class EchoServer {
+public:
+    EchoServer() : listen_fd_(-1), epoll_fd_(-1), port_(0), running_(false) {}
+    ~EchoServer() { stop(); }
+
+    bool start() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (listen_fd_ < 0) return false;
+        int on = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t addr_len = sizeof(addr);
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listen_fd_, SOMAXCONN) != 0 ||
+            getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+
+        epoll_fd_ = epoll_create1(0);
+        if (epoll_fd_ < 0) return false;
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = listen_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+
+        running_ = true;
+        thread_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    void stop() {
+        if (running_.exchange(false)) {
+            thread_.join();
+        }
+        for (auto& item : conns_) close(item.first);
+        conns_.clear();
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+        if (listen_fd_ >= 0) close(listen_fd_);
+        epoll_fd_ = listen_fd_ = -1;
+    }
+
+    std::string url() const { return "ws://127.0.0.1:" + std::to_string(port_) + "/"; }
+
+private:
+    struct Conn {
+        bool open = false;
+        bool closing = false;
+        bool want_write = false;
+        std::string in;
+        std::string out;
+    };
+
+    void run() {
+        std::vector<epoll_event> events(256);
+        while (running_) {
+            int n = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), 100);
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd_) {
+                    acceptAll();
+                    continue;
+                }
+                auto it = conns_.find(fd);
+                if (it == conns_.end()) continue;
+                if (!onEvent(fd, *it->second, events[i].events)) {
+                    closeConn(fd);
+                }
+            }
+        }
+    }
+
+    void acceptAll() {
+        while (true) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0) {
+                // 描述符用尽时监听socket一直可读，稍等再试，避免空转
+                if (errno == EMFILE || errno == ENFILE) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                return;
+            }
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                close(fd);
+                continue;
+            }
+            conns_[fd].reset(new Conn());
+        }
+    }
+
+    bool onEvent(int fd, Conn& conn, uint32_t events) {
+        if (events & (EPOLLERR | EPOLLHUP)) return false;
+
+        if (events & EPOLLIN) {
+            char buf[16384];
+            while (true) {
+                ssize_t n = read(fd, buf, sizeof(buf));
+                if (n > 0) {
+                    conn.in.append(buf, static_cast<size_t>(n));
+                    continue;
+                }
+                if (n == 0) return false;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (!process(conn)) return false;
+        }
+        return flush(fd, conn);
+    }
+
+    bool process(Conn& conn) {
+        if (!conn.open) {
+            size_t end = conn.in.find("\r\n\r\n");
+            if (end == std::string::npos) return true;
+            std::string key;
+            if (!findKey(conn.in.substr(0, end + 2), key)) return false;
+            conn.out += "HTTP/1.1 101 Switching Protocols\r\n"
+                        "Upgrade: websocket\r\n"
+                        "Connection: Upgrade\r\n"
+                        "Sec-WebSocket-Accept: " + acceptKey(key) + "\r\n\r\n";
+            conn.in.erase(0, end + 4);
+            conn.open = true;
+        }
+
+        size_t offset = 0;
+        websocket::WebSocketFrame frame;
+        while (offset < conn.in.size() && !conn.closing) {
+            size_t consumed = 0;
+            if (!websocket::WebSocketFrame::parse(conn.in.data() + offset, conn.in.size() - offset, frame, consumed)) {
+                return false;
+            }
+            if (consumed == 0) break;
+            offset += consumed;
+
+            frame.setMasked(false);
+            if (frame.getOpcode() == static_cast<uint8_t>(websocket::FrameType::PING)) {
+                frame.setOpcode(static_cast<uint8_t>(websocket::FrameType::PONG));
+            } else if (frame.getOpcode() == static_cast<uint8_t>(websocket::FrameType::CLOSE)) {
+                conn.closing = true;
+            } else if (frame.getOpcode() == static_cast<uint8_t>(websocket::FrameType::PONG)) {
+                continue;
+            }
+            conn.out += frame.serialize();
+        }
+        conn.in.erase(0, offset);
+        return true;
+    }
+
+    bool flush(int fd, Conn& conn) {
+        size_t offset = 0;
+        while (offset < conn.out.size()) {
+            ssize_t n = write(fd, conn.out.data() + offset, conn.out.size() - offset);
+            if (n > 0) {
+                offset += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return false;
+        }
+        conn.out.erase(0, offset);
+        if (conn.out.empty() && conn.closing) return false;
+
+        // 写不完时等待可写事件
+        bool want_write = !conn.out.empty();
+        if (want_write != conn.want_write) {
+            epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            if (want_write) ev.events |= EPOLLOUT;
+            ev.data.fd = fd;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+            conn.want_write = want_write;
+        }
+        return true;
+    }
+
+    void closeConn(int fd) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        conns_.erase(fd);
+    }
+
+    static bool findKey(const std::string& headers, std::string& key) {
+        std::string lower = headers;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        size_t pos = lower.find("\r\nsec-websocket-key:");
+        if (pos == std::string::npos) return false;
+        pos += 20;
+        size_t end = headers.find("\r\n", pos);
+        key = websocket::Utils::trim(headers.substr(pos, end - pos));
+        return !key.empty();
+    }
+
+    static std::string acceptKey(const std::string& key) {
+        std::string input = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        unsigned char digest[SHA_DIGEST_LENGTH];
+        SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+        return websocket::Utils::base64Encode(std::string(reinterpret_cast<const char*>(digest), sizeof(digest)));
+    }
+
+    int listen_fd_;
+    int epoll_fd_;
+    int port_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::unordered_map<int, std::unique_ptr<Conn>> conns_;
+};
+
+// 每条连接同一时刻只有一条消息在途(闭环)，负载随连接数增长
+struct Connection {
+    std::unique_ptr<websocket::WebSocketClient> client;
+    std::atomic<bool> in_flight{false};
+};
+
+struct LevelResult {
+    size_t connections = 0;
+    double connect_rate = 0;
+    double kb_per_connection = 0;
+    double threads_per_connection = 0;
+    double messages_per_second = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+};
+
+class ScaleBenchmark {
+public:
+    explicit ScaleBenchmark(const ScaleOptions& options) : options_(options), received_(0) {}
+
+    bool startServers() {
+        for (size_t i = 0; i < options_.servers; ++i) {
+            std::unique_ptr<EchoServer> server(new EchoServer());
+            if (!server->start()) {
+                std::cerr << "无法启动本地服务端: " << strerror(errno) << std::endl;
+                return false;
+            }
+            urls_.push_back(server->url());
+            servers_.push_back(std::move(server));
+        }
+        return true;
+    }
+
+    void baseline() {
+        base_rss_kb_ = readStatus("VmRSS");
+        base_threads_ = readStatus("Threads");
+    }
+
+    // 增加连接到target条，返回实际达到的连接数
+    size_t grow(size_t target, double& connect_rate) {
+        size_t first = conns_.size();
+        conns_.resize(target);
+        for (size_t i = first; i < target; ++i) {
+            conns_[i].reset(new Connection());
+        }
+
+        std::atomic<size_t> next(first);
+        std::atomic<size_t> failed_at(target);
+        std::string first_error;
+        std::mutex error_mutex;
+
+        int64_t start = nowNs();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < options_.connect_threads; ++t) {
+            workers.emplace_back([&] {
+                while (true) {
+                    size_t index = next.fetch_add(1);
+                    if (index >= target || index >= failed_at.load()) return;
+                    Connection* conn = conns_[index].get();
+                    conn->client.reset(new websocket::WebSocketClient());
+                    conn->client->setOnMsgText([this, conn](const std::string& message) { onEcho(conn, message); });
+                    websocket::WebSocketResult res = conn->client->connect_sync(urls_[index % urls_.size()]);
+                    if (!res) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (index < failed_at.load()) {
+                            failed_at = index;
+                            first_error = res.message();
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        int64_t elapsed = nowNs() - start;
+
+        size_t reached = std::min(target, failed_at.load());
+        if (reached < target) {
+            std::cerr << "第 " << reached + 1 << " 条连接失败: " << first_error
+                      << " (检查 ulimit -n、kernel.threads-max、vm.max_map_count)" << std::endl;
+            conns_.resize(reached);
+        }
+        connect_rate = elapsed > 0 ? (reached - first) * 1e9 / elapsed : 0;
+        return reached;
+    }
+
+    LevelResult measure(double connect_rate) {
+        LevelResult result;
+        result.connections = conns_.size();
+        result.connect_rate = connect_rate;
+        if (conns_.empty()) return result;
+
+        result.kb_per_connection = static_cast<double>(readStatus("VmRSS") - base_rss_kb_) / conns_.size();
+        result.threads_per_connection = static_cast<double>(readStatus("Threads") - base_threads_) / conns_.size();
+
+        histogram_.clear();
+        received_ = 0;
+        std::atomic<bool> running(true);
+        std::vector<std::thread> drivers;
+        int64_t start = nowNs();
+        for (size_t t = 0; t < options_.driver_threads; ++t) {
+            drivers.emplace_back([this, t, &running] { drive(t, running); });
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(options_.seconds));
+        running = false;
+        for (auto& driver : drivers) driver.join();
+        uint64_t received = received_.load();
+        int64_t elapsed = nowNs() - start;
+
+        // 等在途消息回来，避免计入下一级
+        int64_t deadline = nowNs() + 2000000000LL;
+        while (nowNs() < deadline && inFlight() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        result.messages_per_second = received * 1e9 / elapsed;
+        result.p50_ns = histogram_.percentile(0.50);
+        result.p99_ns = histogram_.percentile(0.99);
+        return result;
+    }
+
+    void shutdown() {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < options_.connect_threads; ++t) {
+            workers.emplace_back([this, &next] {
+                for (size_t index = next.fetch_add(1); index < conns_.size(); index = next.fetch_add(1)) {
+                    conns_[index]->client.reset();
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        conns_.clear();
+        for (auto& server : servers_) server->stop();
+    }
+
+private:
+    // 每个发送线程负责一部分连接，轮流给没有在途消息的连接发送带时间戳的消息
+    void drive(size_t index, const std::atomic<bool>& running) {
+        std::string padding(options_.message_size > 20 ? options_.message_size - 20 : 0, 'x');
+        while (running) {
+            size_t sent = 0;
+            for (size_t i = index; i < conns_.size() && running; i += options_.driver_threads) {
+                Connection* conn = conns_[i].get();
+                if (conn->in_flight.exchange(true)) continue;
+                char stamp[21];
+                snprintf(stamp, sizeof(stamp), "%020lld", static_cast<long long>(nowNs()));
+                if (!conn->client->sendAsync(stamp + padding)) {
+                    conn->in_flight = false;
+                    continue;
+                }
+                ++sent;
+            }
+            if (sent == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+
+    void onEcho(Connection* conn, const std::string& message) {
+        histogram_.record(nowNs() - std::strtoll(message.c_str(), nullptr, 10));
+        received_.fetch_add(1, std::memory_order_relaxed);
+        conn->in_flight = false;
+    }
+
+    size_t inFlight() const {
+        size_t count = 0;
+        for (const auto& conn : conns_) count += conn->in_flight.load() ? 1 : 0;
+        return count;
+    }
+
+    ScaleOptions options_;
+    std::vector<std::unique_ptr<EchoServer>> servers_;
+    std::vector<std::string> urls_;
+    std::vector<std::unique_ptr<Connection>> conns_;
+    LatencyHistogram histogram_;
+    std::atomic<uint64_t> received_;
+    long base_rss_kb_ = 0;
+    long base_threads_ = 0;
+};
+
+// 把描述符上限提到硬上限，返回能容纳的连接数；每条连接在本进程内占用客户端和服务端两个描述符。
+// 超过500条连接后描述符号会超过FD_SETSIZE，依赖NetworkConnection用poll等待socket
+size_t raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return 0;
+    }
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    std::cout << "文件描述符上限: " << limit.rlim_cur << std::endl;
+
+    const rlim_t reserved = 256;   // 留给服务端监听、epoll和进程其他用途
+    return limit.rlim_cur > reserved ? static_cast<size_t>((limit.rlim_cur - reserved) / 2) : 0;
+}
+
+// 按显示宽度右对齐，中文字符占两列
+std::string pad(const std::string& text, size_t width) {
+    size_t columns = 0;
+    for (unsigned char c : text) {
+        if (c < 0x80) columns += 1;
+        else if (c >= 0xE0) columns += 2;
+    }
+    return std::string(width > columns ? width - columns : 0, ' ') + text;
+}
+
+void printHeader() {
+    std::cout << pad("连接数", 8) << pad("建连(/s)", 14) << pad("内存(KB/连接)", 14) << pad("线程/连接", 12)
+              << pad("吞吐(msg/s)", 14) << pad("p50(us)", 12) << pad("p99(us)", 12) << std::endl;
+}
+
+void printResult(const LevelResult& r) {
+    std::cout << std::right << std::fixed
+              << std::setw(8) << r.connections
+              << std::setw(14) << std::setprecision(0) << r.connect_rate
+              << std::setw(14) << std::setprecision(1) << r.kb_per_connection
+              << std::setw(12) << std::setprecision(2) << r.threads_per_connection
+              << std::setw(14) << std::setprecision(0) << r.messages_per_second
+              << std::setw(12) << std::setprecision(1) << r.p50_ns / 1000.0
+              << std::setw(12) << r.p99_ns / 1000.0 << std::endl;
+}
+
+void usage() {
+    std::cerr << "用法: websocket_scale_benchmark [-c 1000,10000,50000] [-S 服务端数] [-j 建连线程数] "
+                 "[-t 发送线程数] [-d 每级秒数] [-s 消息大小]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ScaleOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-c" && i + 1 < argc) {
+            options.levels.clear();
+            for (const auto& item : websocket::Utils::split(argv[++i], ',')) {
+                options.levels.push_back(std::strtoul(item.c_str(), nullptr, 10));
+            }
+        } else if ((arg == "-S" || arg == "-j" || arg == "-t" || arg == "-d" || arg == "-s") && i + 1 < argc) {
+            unsigned long value = std::strtoul(argv[++i], nullptr, 10);
+            if (arg == "-S") options.servers = value;
+            else if (arg == "-j") options.connect_threads = value;
+            else if (arg == "-t") options.driver_threads = value;
+            else if (arg == "-d") options.seconds = static_cast<int>(value);
+            else options.message_size = value;
+        } else {
+            usage();
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::sort(options.levels.begin(), options.levels.end());
+    if (options.levels.empty() || options.levels.front() == 0 || options.servers == 0 ||
+        options.connect_threads == 0 || options.driver_threads == 0 || options.seconds <= 0) {
+        usage();
+        return 1;
+    }
+
+    std::cout << "=== 多连接扩展性测试 ===" << std::endl;
+    size_t max_connections = raiseFileLimit();
+    if (options.levels.back() > max_connections) {
+        std::cout << "描述符上限最多支持 " << max_connections << " 条连接，超出的级别将被截断 (ulimit -n)" << std::endl;
+        while (!options.levels.empty() && options.levels.back() > max_connections) options.levels.pop_back();
+        if (max_connections > 0 && (options.levels.empty() || options.levels.back() < max_connections)) {
+            options.levels.push_back(max_connections);
+        }
+    }
+    if (options.levels.empty()) {
+        return 1;
+    }
+
+    ScaleBenchmark benchmark(options);
+    benchmark.baseline();
+    if (!benchmark.startServers()) {
+        return 1;
+    }
+    std::cout << "本地服务端: " << options.servers << "，每级测量 " << options.seconds << " 秒，消息 "
+              << options.message_size << " 字节" << std::endl;
+    printHeader();
+
+    for (size_t level : options.levels) {
+        double connect_rate = 0;
+        size_t reached = benchmark.grow(level, connect_rate);
+        printResult(benchmark.measure(connect_rate));
+        if (reached < level) break;
+    }
+
+    benchmark.shutdown();
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cerr << "websocket_scale_benchmark 仅支持Linux" << std::endl;
+    return 1;
+}
+
+#endif
@@ -5,12 +5,17 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
 #include <memory>
 #include <functional>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <deque>
+#include <future>
 #include <atomic>
 #include <chrono>
 #include <random>
@@ -18,8 +23,15 @@
 #include <iomanip>
 #include <cstring>
 #include <cstdint>
+#include <limits>
 #include <cassert>
 
+#if defined(__has_include)
+#if __has_include(<span>) && __cplusplus >= 202002L
+#include <span>
+#endif
+#endif
+
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -32,16 +44,39 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
+#include <openssl/evp.h>
 
 #ifdef USE_ZLIB
+#ifdef USE_ZLIB_NG
+#include <zlib-ng.h>
+#else
 #include <zlib.h>
 #endif
+#ifdef USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#endif
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#define WEBSOCKET_HAS_COROUTINES 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define WEBSOCKET_HAS_X86_SIMD 1
+#endif
 
 namespace websocket {
 
@@ -58,7 +93,8 @@ enum class ResultCode {
     CLOSED,
     INVALID_STATE,
     BUFFER_OVERFLOW,
-    INVALID_PARAMETER
+    INVALID_PARAMETER,
+    CANCELLED
 };
 
 class WebSocketResult {
@@ -72,7 +108,7 @@ public:
     WebSocketResult& operator=(WebSocketResult&&) = default;
 
     explicit operator bool() const noexcept { return code_ == ResultCode::SUCCESS; }
-    explicit bool operator!() const noexcept { return code_ != ResultCode::SUCCESS; }
+    bool operator!() const noexcept { return code_ != ResultCode::SUCCESS; }
 
     ResultCode code() const noexcept { return code_; }
     const std::string& message() const noexcept { return message_; }
@@ -98,18 +134,102 @@ enum class WebSocketState {
     CLOSED
 };
 
+// 发送优先级，数值越小越优先
+enum class SendPriority {
+    CONTROL = 0,  // PING/PONG/CLOSE，可插入数据消息的分片之间
+    URGENT,
+    NORMAL,
+    BULK
+};
+
+// 忙轮询低延迟模式参数
+struct BusyPollOptions {
+    bool enabled = false;
+    int cpu = -1;                  // I/O线程绑定的CPU核，-1表示不绑定
+    int spin_budget_us = 200;      // 进入select等待前自旋读取的时间(微秒)
+    int socket_busy_poll_us = 50;  // SO_BUSY_POLL，内核在读socket时忙轮询网卡队列的时间(微秒)
+};
+
+// socket调优参数，取值-1表示使用内核默认值
+struct SocketOptions {
+    int recv_buffer = -1;          // SO_RCVBUF(字节)，设置后内核不再自动调整
+    int send_buffer = -1;          // SO_SNDBUF(字节)
+    int tcp_nodelay = -1;          // TCP_NODELAY，1关闭Nagle算法
+    int notsent_lowat = -1;        // TCP_NOTSENT_LOWAT(字节)，限制内核中未发送数据量
+    int user_timeout_ms = -1;      // TCP_USER_TIMEOUT，未确认数据超过该时间即断开
+    int keepalive = -1;            // SO_KEEPALIVE
+    int keepalive_idle_s = -1;     // TCP_KEEPIDLE
+    int keepalive_interval_s = -1; // TCP_KEEPINTVL
+    int keepalive_count = -1;      // TCP_KEEPCNT
+    int tos = -1;                  // IP_TOS/IPV6_TCLASS，DSCP左移2位
+
+    // 低延迟预设：关闭Nagle，限制未发送数据，快速探测断线，DSCP EF
+    static SocketOptions lowLatency() {
+        SocketOptions options;
+        options.tcp_nodelay = 1;
+        options.notsent_lowat = 16 * 1024;
+        options.user_timeout_ms = 10000;
+        options.keepalive = 1;
+        options.keepalive_idle_s = 10;
+        options.keepalive_interval_s = 5;
+        options.keepalive_count = 3;
+        options.tos = 46 << 2;
+        return options;
+    }
+
+    // 大吞吐预设：大缓冲区，保留Nagle，DSCP AF11
+    static SocketOptions bulk() {
+        SocketOptions options;
+        options.recv_buffer = 4 * 1024 * 1024;
+        options.send_buffer = 4 * 1024 * 1024;
+        options.tcp_nodelay = 0;
+        options.keepalive = 1;
+        options.keepalive_idle_s = 60;
+        options.keepalive_interval_s = 10;
+        options.keepalive_count = 5;
+        options.tos = 10 << 2;
+        return options;
+    }
+};
+
+// 消息投递方式
+enum class DeliveryMode {
+    CALLBACK,  // 在回调线程调用setOnMsgText/setOnMsgBinary设置的回调
+    QUEUE      // 放入连接的接收队列，由receive()等接口拉取
+};
+
+// 发送队列满时的处理策略
+enum class SendQueuePolicy {
+    REJECT,       // 拒绝新消息，返回BUFFER_OVERFLOW
+    BLOCK,        // 阻塞调用者直到有空间或超时
+    DROP_OLDEST   // 丢弃最早入队且未开始发送的消息
+};
+
 // Config
 class WebSocketConfig {
 public:
     WebSocketConfig() {
         timeout_ms_ = 5000;
         max_frame_size_ = 1024 * 1024; // 1MB
+        max_message_size_ = 16 * 1024 * 1024; // 16MB
         enable_compression_ = false;
         compression_level_ = 6;
+        compression_window_bits_ = 15;
+        compression_mem_level_ = 8;
+        compression_context_takeover_ = true;
+        compression_offload_threshold_ = 1024 * 1024; // 1MB
         ping_interval_ms_ = 30000; // 30秒
         pong_timeout_ms_ = 10000;  // 10秒
         max_reconnect_attempts_ = 3;
         reconnect_delay_ms_ = 1000;
+        receive_high_watermark_ = 4096;
+        receive_low_watermark_ = 1024;
+        max_send_queue_bytes_ = 16 * 1024 * 1024; // 16MB
+        send_queue_policy_ = SendQueuePolicy::REJECT;
+        send_fragment_size_ = 64 * 1024; // 64KB
+        delivery_mode_ = DeliveryMode::CALLBACK;
+        validate_utf8_ = true;
+        recording_segment_bytes_ = 64 * 1024 * 1024; // 64MB
     }
 
     // 设置超时时间
@@ -120,6 +240,10 @@ public:
     void setMaxFrameSize(size_t size) { max_frame_size_ = size; }
     size_t getMaxFrameSize() const { return max_frame_size_; }
 
+    // 设置消息上限(分片重组或解压后的大小)，超出时以1009关闭连接，0表示不限制
+    void setMaxMessageSize(size_t size) { max_message_size_ = size; }
+    size_t getMaxMessageSize() const { return max_message_size_; }
+
     // 启用/禁用压缩
     void enableCompression(bool enable) { enable_compression_ = enable; }
     bool isCompressionEnabled() const { return enable_compression_; }
@@ -130,6 +254,36 @@ public:
     }
     int getCompressionLevel() const { return compression_level_; }
 
+    // 设置压缩窗口(9-15)与memLevel(1-9)，越小每个连接占用的压缩状态越少，
+    // 窗口需与协商的 client_max_window_bits/server_max_window_bits 一致
+    void setCompressionWindowBits(int bits) {
+        if (bits >= 9 && bits <= 15) compression_window_bits_ = bits;
+    }
+    int getCompressionWindowBits() const { return compression_window_bits_; }
+
+    void setCompressionMemLevel(int level) {
+        if (level >= 1 && level <= 9) compression_mem_level_ = level;
+    }
+    int getCompressionMemLevel() const { return compression_mem_level_; }
+
+    // 关闭上下文接管(对应 client_no_context_takeover/server_no_context_takeover)，
+    // 每条消息独立压缩，压缩上下文由所有连接共享的池提供
+    void setCompressionContextTakeover(bool enable) { compression_context_takeover_ = enable; }
+    bool isCompressionContextTakeover() const { return compression_context_takeover_; }
+
+    // 超过此大小的消息在共享线程池上压缩/解压，同一连接的消息顺序不变，0表示不转移
+    void setCompressionOffloadThreshold(size_t bytes) { compression_offload_threshold_ = bytes; }
+    size_t getCompressionOffloadThreshold() const { return compression_offload_threshold_; }
+
+    // 设置预置字典，id通过permessage-deflate的dictionary_id参数协商，服务端在响应中带回相同id才启用，
+    // 字典可用 websocket_dict_trainer 从抓取的消息中训练
+    void setCompressionDictionary(const std::string& id, const std::string& dictionary) {
+        compression_dictionary_id_ = id;
+        compression_dictionary_ = dictionary;
+    }
+    const std::string& getCompressionDictionaryId() const { return compression_dictionary_id_; }
+    const std::string& getCompressionDictionary() const { return compression_dictionary_; }
+
     // 设置ping间隔
     void setPingInterval(int interval_ms) { ping_interval_ms_ = interval_ms; }
     int getPingInterval() const { return ping_interval_ms_; }
@@ -145,6 +299,50 @@ public:
     void setReconnectDelay(int delay_ms) { reconnect_delay_ms_ = delay_ms; }
     int getReconnectDelay() const { return reconnect_delay_ms_; }
 
+    // 设置接收流控水位(未投递消息数)，high为0表示不限制
+    void setReceiveWatermarks(size_t high, size_t low) {
+        receive_high_watermark_ = high;
+        receive_low_watermark_ = (low < high) ? low : high;
+    }
+    size_t getReceiveHighWatermark() const { return receive_high_watermark_; }
+    size_t getReceiveLowWatermark() const { return receive_low_watermark_; }
+
+    // 设置发送队列上限(字节)，0表示不限制
+    void setMaxSendQueueBytes(size_t bytes) { max_send_queue_bytes_ = bytes; }
+    size_t getMaxSendQueueBytes() const { return max_send_queue_bytes_; }
+
+    // 设置发送队列满时的策略
+    void setSendQueuePolicy(SendQueuePolicy policy) { send_queue_policy_ = policy; }
+    SendQueuePolicy getSendQueuePolicy() const { return send_queue_policy_; }
+
+    // 设置发送分片大小，大消息按此拆帧以便控制帧插队，0表示不分片
+    void setSendFragmentSize(size_t size) { send_fragment_size_ = size; }
+    size_t getSendFragmentSize() const { return send_fragment_size_; }
+
+    // 设置消息投递方式
+    void setDeliveryMode(DeliveryMode mode) { delivery_mode_ = mode; }
+    DeliveryMode getDeliveryMode() const { return delivery_mode_; }
+
+    // 启用/禁用文本消息UTF-8校验，RFC 6455要求校验，仅在信任服务端时关闭
+    void enableUtf8Validation(bool enable) { validate_utf8_ = enable; }
+    bool isUtf8ValidationEnabled() const { return validate_utf8_; }
+
+    // 设置忙轮询低延迟模式
+    void setBusyPoll(const BusyPollOptions& options) { busy_poll_ = options; }
+    const BusyPollOptions& getBusyPoll() const { return busy_poll_; }
+
+    // 设置socket调优参数，在创建socket时应用
+    void setSocketOptions(const SocketOptions& options) { socket_options_ = options; }
+    const SocketOptions& getSocketOptions() const { return socket_options_; }
+
+    // 录制收发的每一帧到内存映射的分段文件 <prefix>.NNNNNN.wsrec，prefix为空表示不录制
+    void setTrafficRecording(const std::string& prefix, size_t segment_bytes = 64 * 1024 * 1024) {
+        recording_prefix_ = prefix;
+        recording_segment_bytes_ = segment_bytes;
+    }
+    const std::string& getRecordingPrefix() const { return recording_prefix_; }
+    size_t getRecordingSegmentBytes() const { return recording_segment_bytes_; }
+
     // 设置自定义头部
     void addHeader(const std::string& key, const std::string& value) {
         headers_[key] = value;
@@ -160,34 +358,182 @@ public:
 private:
     int timeout_ms_;
     size_t max_frame_size_;
+    size_t max_message_size_;
     bool enable_compression_;
     int compression_level_;
+    int compression_window_bits_;
+    int compression_mem_level_;
+    bool compression_context_takeover_;
+    size_t compression_offload_threshold_;
+    std::string compression_dictionary_id_;
+    std::string compression_dictionary_;
+    std::string recording_prefix_;
+    size_t recording_segment_bytes_;
     int ping_interval_ms_;
     int pong_timeout_ms_;
     int max_reconnect_attempts_;
     int reconnect_delay_ms_;
+    size_t receive_high_watermark_;
+    size_t receive_low_watermark_;
+    size_t max_send_queue_bytes_;
+    SendQueuePolicy send_queue_policy_;
+    size_t send_fragment_size_;
+    DeliveryMode delivery_mode_;
+    bool validate_utf8_;
+    BusyPollOptions busy_poll_;
+    SocketOptions socket_options_;
     std::map<std::string, std::string> headers_;
     std::map<std::string, std::string> extensions_;
 };
 
+// 线程私有的快速随机源：用RAND_bytes取得的密钥做AES-128-CTR，按块生成密钥流
+// 用于掩码和握手nonce，每个线程一份，取随机数无需加锁和系统调用
+class FastRandom {
+public:
+    ~FastRandom() {
+        if (ctx_) {
+            EVP_CIPHER_CTX_free(ctx_);
+        }
+    }
+
+    FastRandom(const FastRandom&) = delete;
+    FastRandom& operator=(const FastRandom&) = delete;
+
+    static FastRandom& local() {
+        static thread_local FastRandom instance;
+        return instance;
+    }
+
+    // 返回false表示系统随机源不可用，out被清零，调用者必须按失败处理
+    bool fill(void* out, size_t len) {
+        // fork后子进程不能继续使用父进程的密钥流
+        unsigned generation = forkGeneration().load(std::memory_order_relaxed);
+        if (generation != generation_) {
+            generation_ = generation;
+            generated_ = reseed_bytes;
+            pos_ = sizeof(block_);
+        }
+
+        unsigned char* dst = static_cast<unsigned char*>(out);
+        size_t total = len;
+        while (len > 0) {
+            if (pos_ == sizeof(block_) && !refill()) {
+                OPENSSL_cleanse(out, total);
+                return false;
+            }
+            size_t n = std::min(len, sizeof(block_) - pos_);
+            memcpy(dst, block_ + pos_, n);
+            // 已取出的密钥流立即清除
+            memset(block_ + pos_, 0, n);
+            pos_ += n;
+            dst += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    bool next32(uint32_t& value) {
+        return fill(&value, sizeof(value));
+    }
+
+private:
+    FastRandom() : ctx_(nullptr), pos_(sizeof(block_)), generated_(0) {
+        #ifndef _WIN32
+        static std::once_flag once;
+        std::call_once(once, [] {
+            pthread_atfork(nullptr, nullptr, [] { forkGeneration().fetch_add(1, std::memory_order_relaxed); });
+        });
+        #endif
+        generation_ = forkGeneration().load(std::memory_order_relaxed);
+    }
+
+    bool refill() {
+        // 输出量达到上限或fork后重新取密钥
+        if (!ctx_ || generated_ >= reseed_bytes) {
+            reseed();
+        }
+
+        int outlen = 0;
+        if (ctx_) {
+            // 加密全零块，得到的即为CTR密钥流
+            memset(block_, 0, sizeof(block_));
+            if (EVP_EncryptUpdate(ctx_, block_, &outlen, block_, sizeof(block_)) != 1 || outlen != static_cast<int>(sizeof(block_))) {
+                outlen = 0;
+            }
+        }
+        if (outlen == 0 && RAND_bytes(block_, sizeof(block_)) != 1) {
+            // 保持pos_不变，下次调用重试
+            return false;
+        }
+
+        generated_ += sizeof(block_);
+        pos_ = 0;
+        return true;
+    }
+
+    void reseed() {
+        unsigned char seed[32];
+        if (RAND_bytes(seed, sizeof(seed)) == 1) {
+            if (!ctx_) {
+                ctx_ = EVP_CIPHER_CTX_new();
+            }
+            if (ctx_ && EVP_EncryptInit_ex(ctx_, EVP_aes_128_ctr(), nullptr, seed, seed + 16) != 1) {
+                EVP_CIPHER_CTX_free(ctx_);
+                ctx_ = nullptr;
+            }
+        }
+        OPENSSL_cleanse(seed, sizeof(seed));
+        generated_ = 0;
+    }
+
+    // 每次fork在子进程中加一
+    static std::atomic<unsigned>& forkGeneration() {
+        static std::atomic<unsigned> generation(0);
+        return generation;
+    }
+
+    static const uint64_t reseed_bytes = 1ULL << 30;
+
+    EVP_CIPHER_CTX* ctx_;
+    unsigned char block_[4096];
+    size_t pos_;
+    uint64_t generated_;
+    unsigned generation_;
+};
+
 // 工具类
 class Utils {
 public:
-    // 生成随机字符串
+    // 生成随机字符串，随机源不可用时返回空串
     static std::string generateRandomString(size_t length) {
-        static const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, chars.size() - 1);
+        static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+        const size_t chars_size = sizeof(chars) - 1;
+        FastRandom& random = FastRandom::local();
         
         std::string result;
         result.reserve(length);
-        for (size_t i = 0; i < length; ++i) {
-            result += chars[dis(gen)];
+        while (result.size() < length) {
+            unsigned char byte;
+            if (!random.fill(&byte, 1)) {
+                return std::string();
+            }
+            // 丢弃超出整倍数的取值，避免取模偏差
+            if (byte < 256 - 256 % chars_size) {
+                result += chars[byte % chars_size];
+            }
         }
         return result;
     }
 
+    // 生成4字节帧掩码，短字符串不分配堆内存；随机源不可用时返回空串
+    static std::string generateMaskKey() {
+        char key[4];
+        if (!FastRandom::local().fill(key, sizeof(key))) {
+            return std::string();
+        }
+        return std::string(key, sizeof(key));
+    }
+
     // Base64编码
     static std::string base64Encode(const std::string& input) {
         static const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -238,6 +584,19 @@ public:
         return str.substr(start, end - start + 1);
     }
 
+    // 将当前线程绑定到指定CPU核，仅Linux支持
+    static bool pinCurrentThread(int cpu) {
+        #ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        #else
+        (void)cpu;
+        return false;
+        #endif
+    }
+
     // 字符串转小写
     static std::string toLower(const std::string& str) {
         std::string result = str;
@@ -246,17 +605,165 @@ public:
     }
 };
 
+// UTF-8校验器，可跨分片增量校验，非法序列立即失败
+// ASCII段用SIMD整块跳过(运行时选择AVX2/SSE2)，遇到多字节字符时退回标量状态机
+class Utf8Validator {
+public:
+    Utf8Validator() : need_(0), lo_(0x80), hi_(0xBF), valid_(true) {}
+
+    void reset() {
+        need_ = 0;
+        lo_ = 0x80;
+        hi_ = 0xBF;
+        valid_ = true;
+    }
+
+    // 校验一段数据，返回false表示已出现非法序列
+    bool feed(const char* data, size_t len) {
+        if (!valid_) return false;
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        const uint8_t* end = p + len;
+        while (p < end) {
+            if (need_ == 0) {
+                p += asciiPrefix(p, static_cast<size_t>(end - p));
+                if (p == end) break;
+            }
+
+            uint8_t c = *p++;
+            if (need_ == 0) {
+                if (c < 0x80) continue;
+                if (!leadByte(c)) {
+                    valid_ = false;
+                    return false;
+                }
+            } else {
+                if (c < lo_ || c > hi_) {
+                    valid_ = false;
+                    return false;
+                }
+                --need_;
+                lo_ = 0x80;
+                hi_ = 0xBF;
+            }
+        }
+        return true;
+    }
+
+    bool feed(const std::string& data) { return feed(data.data(), data.size()); }
+
+    // 消息结束时调用，字符被截断也视为非法
+    bool finish() const { return valid_ && need_ == 0; }
+
+    static bool validate(const char* data, size_t len) {
+        Utf8Validator validator;
+        return validator.feed(data, len) && validator.finish();
+    }
+
+private:
+    typedef size_t (*PrefixFunc)(const uint8_t*, size_t);
+
+    // 按RFC 3629表3-7设置后续字节数及下一字节允许范围
+    bool leadByte(uint8_t c) {
+        if (c >= 0xC2 && c <= 0xDF) {
+            need_ = 1;
+        } else if (c == 0xE0) {
+            need_ = 2; lo_ = 0xA0;
+        } else if ((c >= 0xE1 && c <= 0xEC) || c == 0xEE || c == 0xEF) {
+            need_ = 2;
+        } else if (c == 0xED) {
+            need_ = 2; hi_ = 0x9F;   // 排除代理项
+        } else if (c == 0xF0) {
+            need_ = 3; lo_ = 0x90;
+        } else if (c >= 0xF1 && c <= 0xF3) {
+            need_ = 3;
+        } else if (c == 0xF4) {
+            need_ = 3; hi_ = 0x8F;   // 不超过U+10FFFF
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // 返回开头连续ASCII字节数
+    static size_t asciiPrefix(const uint8_t* p, size_t len) {
+        static const PrefixFunc func = selectPrefixFunc();
+        return func(p, len);
+    }
+
+    static PrefixFunc selectPrefixFunc() {
+        #ifdef WEBSOCKET_HAS_X86_SIMD
+        if (__builtin_cpu_supports("avx2")) return &asciiPrefixAvx2;
+        if (__builtin_cpu_supports("sse2")) return &asciiPrefixSse2;
+        #endif
+        return &asciiPrefixScalar;
+    }
+
+    static size_t asciiPrefixScalar(const uint8_t* p, size_t len) {
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+            uint64_t word;
+            memcpy(&word, p + i, sizeof(word));
+            if (word & 0x8080808080808080ULL) break;
+        }
+        while (i < len && p[i] < 0x80) ++i;
+        return i;
+    }
+
+    #ifdef WEBSOCKET_HAS_X86_SIMD
+    __attribute__((target("sse2")))
+    static size_t asciiPrefixSse2(const uint8_t* p, size_t len) {
+        size_t i = 0;
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            if (_mm_movemask_epi8(v) != 0) break;
+        }
+        return i + asciiPrefixScalar(p + i, len - i);
+    }
+
+    __attribute__((target("avx2")))
+    static size_t asciiPrefixAvx2(const uint8_t* p, size_t len) {
+        size_t i = 0;
+        for (; i + 64 <= len; i += 64) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 32));
+            if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) != 0) break;
+        }
+        for (; i + 32 <= len; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            if (_mm256_movemask_epi8(v) != 0) break;
+        }
+        return i + asciiPrefixScalar(p + i, len - i);
+    }
+    #endif
+
+    uint8_t need_;   // 当前字符还需的后续字节数
+    uint8_t lo_;     // 下一字节允许的最小值
+    uint8_t hi_;     // 下一字节允许的最大值
+    bool valid_;
+};
+
 // URL解析类
 class URL {
 public:
-    std::string scheme() const noexcept { return scheme_; }
-    std::string host() const noexcept { return host_; }
+    const std::string& scheme() const noexcept { return scheme_; }
+    const std::string& host() const noexcept { return host_; }
     int port() const noexcept { return port_; }
-    std::string path() const noexcept { return path_; }
-    std::string query() const noexcept { return query_; }
+    const std::string& path() const noexcept { return path_; }
+    const std::string& query() const noexcept { return query_; }
+
+    // Host头中的主机，IPv6字面量需要加方括号
+    std::string hostHeader() const {
+        return host_.find(':') != std::string::npos ? "[" + host_ + "]" : host_;
+    }
 
     WebSocketResult parse(const std::string& url) noexcept {
         size_t pos = 0;
+        scheme_.clear();
+        host_.clear();
+        port_ = 0;
+        path_.clear();
+        query_.clear();
         
         // 解析协议
         size_t scheme_end = url.find("://");
@@ -274,20 +781,41 @@ public:
         }
 
         std::string host_port = url.substr(pos, host_end - pos);
-        size_t colon_pos = host_port.find(':');
-        if (colon_pos != std::string::npos) {
+        size_t colon_pos = std::string::npos;
+        if (!host_port.empty() && host_port[0] == '[') {
+            // IPv6字面量 [::1]:port，主机不含方括号
+            size_t bracket_end = host_port.find(']');
+            if (bracket_end == std::string::npos) {
+                return WebSocketResult(ResultCode::URL_ERROR,"Invalid URL: unterminated IPv6 address");
+            }
+            host_ = host_port.substr(1, bracket_end - 1);
+            if (host_.find_first_not_of("0123456789abcdefABCDEF:.") != std::string::npos) {
+                return WebSocketResult(ResultCode::URL_ERROR,"Invalid URL: invalid IPv6 address");
+            }
+            if (bracket_end + 1 < host_port.length()) {
+                if (host_port[bracket_end + 1] != ':') {
+                    return WebSocketResult(ResultCode::URL_ERROR,"Invalid URL: invalid IPv6 address");
+                }
+                colon_pos = bracket_end + 1;
+            }
+        } else {
+            colon_pos = host_port.find(':');
             host_ = host_port.substr(0, colon_pos);
-            port_ = std::stoi(host_port.substr(colon_pos + 1));
+        }
+
+        if (colon_pos != std::string::npos) {
+            std::string port = host_port.substr(colon_pos + 1);
 
-            if (std::to_string(port_) != host_port.substr(colon_pos + 1)) {
+            // 不用stoi，非数字或超长的端口会抛异常；端口必须在1-65535之间且没有前导零
+            if (port.empty() || port.size() > 5 || port.find_first_not_of("0123456789") != std::string::npos) {
                 return WebSocketResult(ResultCode::URL_ERROR,"Invalid URL: invalid port number");
             }
-
-            if (port_ <= 0 || port_ > 65535) {
+            int value = atoi(port.c_str());
+            if (value < 1 || value > 65535 || port[0] == '0') {
                 return WebSocketResult(ResultCode::URL_ERROR,"Invalid URL: invalid port number");
             }
+            port_ = value;
         } else {
-            host_ = host_port;
             port_ = (scheme_ == "wss") ? 443 : 80;
         }
 
@@ -325,17 +853,135 @@ private:
 #define SOCKET_ERROR -1
 #endif
 
-// 网络连接类
-class NetworkConnection {
+// TLS层单步读写的结果，WANT_READ/WANT_WRITE表示需要等待socket后重试
+enum class TlsStatus {
+    DONE,
+    WANT_READ,
+    WANT_WRITE,
+    PEER_CLOSED,
+    FAILURE
+};
+
+template <bool Enabled> class TlsLayer;
+
+// 明文连接的TLS层：全部为空操作，不引用任何SSL_*符号
+template <> class TlsLayer<false> {
+public:
+    bool active() const noexcept { return false; }
+    WebSocketResult init(int, const std::string&) noexcept {
+        return WebSocketResult(ResultCode::SSL_ERROR, "TLS not supported by this connection type");
+    }
+    TlsStatus handshake() noexcept { return TlsStatus::FAILURE; }
+    TlsStatus write(const char*, size_t, size_t& written) noexcept { written = 0; return TlsStatus::FAILURE; }
+    TlsStatus read(char*, size_t, size_t& readbytes) noexcept { readbytes = 0; return TlsStatus::FAILURE; }
+    TlsStatus shutdown() noexcept { return TlsStatus::DONE; }
+    bool pending() const noexcept { return false; }
+    void reset() noexcept {}
+    static std::string lastError() { return "TLS not supported"; }
+};
+
+// OpenSSL实现，socket为非阻塞，等待由连接类负责
+template <> class TlsLayer<true> {
+public:
+    TlsLayer() : ssl_ctx_(nullptr), ssl_(nullptr) {}
+    ~TlsLayer() { reset(); }
+
+    bool active() const noexcept { return ssl_ != nullptr; }
+
+    WebSocketResult init(int fd, const std::string& host) noexcept {
+        SSL_library_init();
+        SSL_load_error_strings();
+        OpenSSL_add_all_algorithms();
+
+        ssl_ctx_ = SSL_CTX_new(TLS_client_method());
+        if (!ssl_ctx_) {
+            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to create SSL context: " + lastError());
+        }
+
+        ssl_ = SSL_new(ssl_ctx_);
+        if (!ssl_) {
+            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to create SSL: " + lastError());
+        }
+
+        if (SSL_set_fd(ssl_, fd) != 1) {
+            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to set SSL socket: " + lastError());
+        }
+
+        // SNI不能是IPv6字面量
+        if (host.find(':') == std::string::npos && SSL_set_tlsext_host_name(ssl_, host.c_str()) != 1) {
+            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to set SSL host name: " + lastError());
+        }
+
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+    TlsStatus handshake() noexcept {
+        int ret = SSL_connect(ssl_);
+        return ret > 0 ? TlsStatus::DONE : status(ret);
+    }
+
+    TlsStatus write(const char* data, size_t length, size_t& written) noexcept {
+        written = 0;
+        return SSL_write_ex(ssl_, data, length, &written) == 1 ? TlsStatus::DONE : status(0);
+    }
+
+    TlsStatus read(char* buffer, size_t size, size_t& readbytes) noexcept {
+        readbytes = 0;
+        return SSL_read_ex(ssl_, buffer, size, &readbytes) == 1 ? TlsStatus::DONE : status(0);
+    }
+
+    TlsStatus shutdown() noexcept {
+        int ret = SSL_shutdown(ssl_);
+        return ret >= 0 ? TlsStatus::DONE : status(ret);
+    }
+
+    // TLS层是否已缓存了解密后的数据
+    bool pending() const noexcept { return SSL_pending(ssl_) > 0; }
+
+    void reset() noexcept {
+        if (ssl_) {
+            SSL_free(ssl_);
+            ssl_ = nullptr;
+        }
+        if (ssl_ctx_) {
+            SSL_CTX_free(ssl_ctx_);
+            ssl_ctx_ = nullptr;
+        }
+    }
+
+    static std::string lastError() {
+        const char* reason = ERR_reason_error_string(ERR_get_error());
+        return reason ? reason : "unknown error";
+    }
+
+private:
+    TlsStatus status(int ret) noexcept {
+        switch (SSL_get_error(ssl_, ret)) {
+            case SSL_ERROR_WANT_READ: return TlsStatus::WANT_READ;
+            case SSL_ERROR_WANT_WRITE: return TlsStatus::WANT_WRITE;
+            case SSL_ERROR_ZERO_RETURN: return TlsStatus::PEER_CLOSED;
+            default: return TlsStatus::FAILURE;
+        }
+    }
+
+    SSL_CTX* ssl_ctx_;
+    SSL* ssl_;
+};
+
+// 网络连接类，Tls为false时是纯明文连接，TLS相关代码不参与编译
+template <bool Tls>
+class BasicNetworkConnection {
 public:
-    NetworkConnection() : socket_(INVALID_SOCKET), ssl_ctx_(nullptr), ssl_(nullptr) {
+    static const bool supports_tls = Tls;
+
+    BasicNetworkConnection() : socket_(INVALID_SOCKET) {
         #ifdef _WIN32
         WSADATA wsaData;
         WSAStartup(MAKEWORD(2, 2), &wsaData);
         #endif
     }
 
-    ~NetworkConnection() {
+    ~BasicNetworkConnection() {
         close();
 
         #ifdef _WIN32
@@ -344,6 +990,10 @@ public:
     }
 
     WebSocketResult connect(const std::string& host, int port, bool use_ssl, int timeout_ms) noexcept {
+        if (use_ssl && !Tls) {
+            return WebSocketResult(ResultCode::SSL_ERROR, "TLS not supported by this connection type");
+        }
+
         // 解析主机地址
         struct addrinfo hints, *result;
         memset(&hints, 0, sizeof(hints));
@@ -353,78 +1003,86 @@ public:
         int ret = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result);
         if (ret != 0) {
             #ifdef _WIN32
-            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to resolve host: " + std::string(WSAGetLastError()));
+            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to resolve host: " + std::to_string(ret));
             #else
             return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to resolve host: " + std::string(gai_strerror(ret)));
             #endif
         }
 
-        WebSocketResult result(ResultCode::SUCCESS, "");
-        for (rp = result; rp != NULL; rp = rp->ai_next) {
-            result = connectInternal(rp);
-            if(!result) {
-                continue;
+        // 依次尝试解析出的每个地址，直到连接成功
+        WebSocketResult res(ResultCode::CONNECTION_ERROR, "Failed to connect: no address");
+        for (struct addrinfo* rp = result; rp != NULL; rp = rp->ai_next) {
+            res = connectInternal(rp, timeout_ms);
+            if (res) {
+                break;
             }
+            close();
         }
 
         freeaddrinfo(result);
 
-        if (result && use_ssl) {
-            result = setupSSL();
+        if (res && use_ssl) {
+            res = setupSSL(host, timeout_ms);
         }
 
-        if(!result) {
+        if (!res) {
             close();
         }
 
-        return result;
+        return res;
     }
 
-    WebSocketResult send(const std::string& data) noexcept {
-        if (ssl_) {
-            size_t written = 0;
-            while (SSL_write_ex(ssl_, data.c_str(), data.length(), &written) == 0) {
-                int error = SSL_get_error(ssl_, 0);
-                if(error == SSL_ERROR_WANT_READ) {
-                    fd_set fds;
-                    FD_ZERO(&fds);
-                    FD_SET(SSL_get_fd(ssl_), &fds);
-                    select(SSL_get_fd(ssl_) + 1, &fds, NULL, NULL, NULL);
+    WebSocketResult send(const std::string& data, int timeout_ms = -1) noexcept {
+        return send(data.c_str(), data.length(), timeout_ms);
+    }
+
+    // 发送全部数据，timeout_ms为单次等待socket可写的超时，小于0表示无限等待
+    WebSocketResult send(const char* data, size_t length, int timeout_ms = -1) noexcept {
+        size_t offset = 0;
+        while (offset < length) {
+            if (tls_.active()) {
+                size_t written = 0;
+                TlsStatus status = tls_.write(data + offset, length - offset, written);
+                if (status == TlsStatus::DONE) {
+                    offset += written;
                     continue;
-                } else if(error == SSL_ERROR_WANT_WRITE) {
-                    fd_set fds;
-                    FD_ZERO(&fds);
-                    FD_SET(SSL_get_fd(ssl_), &fds);
-                    select(SSL_get_fd(ssl_) + 1, NULL, &fds, NULL, NULL);
+                }
+
+                if (status == TlsStatus::WANT_READ || status == TlsStatus::WANT_WRITE) {
+                    if (!waitSocket(status == TlsStatus::WANT_READ, timeout_ms)) {
+                        return WebSocketResult(ResultCode::TIMEOUT,"Failed to send: timeout");
+                    }
                     continue;
-                } else {
-                    return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to send: " + std::string(ERR_reason_error_string(ERR_get_error())));
                 }
-            }
-        } else {
-            while(::send(socket_, data.c_str(), data.length(), 0) == SOCKET_ERROR) {
-                #ifdef _WIN32
-                if(WSAGetLastError() == WSAEWOULDBLOCK) {
-                    fd_set fds;
-                    FD_ZERO(&fds);
-                    FD_SET(socket_, &fds);
-                    select(socket_ + 1, NULL, &fds, NULL, NULL);
+
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to send: " + tls_.lastError());
+            } else {
+                // 对端已关闭时返回EPIPE，不产生SIGPIPE
+                #ifdef MSG_NOSIGNAL
+                int ret = ::send(socket_, data + offset, length - offset, MSG_NOSIGNAL);
+                #else
+                int ret = ::send(socket_, data + offset, length - offset, 0);
+                #endif
+                if (ret != SOCKET_ERROR) {
+                    offset += ret;
                     continue;
                 }
+
+                #ifdef _WIN32
+                if(WSAGetLastError() == WSAEWOULDBLOCK) {
                 #else
                 if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                    fd_set fds;
-                    FD_ZERO(&fds);
-                    FD_SET(socket_, &fds);
-                    select(socket_ + 1, NULL, &fds, NULL, NULL);
+                #endif
+                    if (!waitSocket(false, timeout_ms)) {
+                        return WebSocketResult(ResultCode::TIMEOUT,"Failed to send: timeout");
+                    }
                     continue;
                 }
-                #endif
 
                 #ifndef _WIN32
                 return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to send: " + std::string(strerror(errno)));
                 #else
-                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to send: " + std::string(WSAGetLastError()));
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to send: " + std::to_string(WSAGetLastError()));
                 #endif
             }
         }
@@ -432,80 +1090,45 @@ public:
         return WebSocketResult(ResultCode::SUCCESS, "");
     }
 
-    WebSocketResult receive(char* buffer, int size, size& readbytes, int timeout_ms) noexcept {
-        timeval time_out = {0};
-        time_out.tv_sec = timeout_ms / 1000;
-        time_out.tv_usec = (timeout_ms % 1000) * 1000;
-            
-        if (ssl_) {
-            fd_set fds;
-            FD_ZERO(&fds);
-            FD_SET(SSL_get_fd(ssl_), &fds);
-            select(SSL_get_fd(ssl_) + 1, &fds, NULL, NULL, &time_out);
-        
-            readbytes = 0;
-            if (SSL_read_ex(ssl_, buffer, size, &readbytes) == 0) {
-                int error = SSL_get_error(ssl_, 0);
-                if(error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
-                    return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to recv: " + std::string(ERR_reason_error_string(ERR_get_error())));
-                }
-            }
-
-            return WebSocketResult(ResultCode::SUCCESS, "");
-        } else {
-            fd_set fds;
-            FD_ZERO(&fds);
-            FD_SET(socket_, &fds);
-            select(socket_ + 1, &fds, NULL, NULL, &time_out);
+    WebSocketResult receive(char* buffer, int size, size_t& readbytes, int timeout_ms) noexcept {
+        readbytes = 0;
 
-            int ret = ::recv(socket_, buffer, size, 0);
-            if(ret == 0) {
-                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Connection closed by peer");
-            } else if(ret == SOCKET_ERROR) {
-                #ifdef _WIN32
-                if(WSAGetLastError() != WSAEWOULDBLOCK) {
-                    return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to recv: " + std::string(WSAGetLastError()));
-                }
-                #else
-                if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                    return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to recv: " + std::string(strerror(errno)));
+        // 忙轮询：先自旋非阻塞读取，预算用完再进入select等待
+        if (busy_poll_.enabled && busy_poll_.spin_budget_us > 0) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(busy_poll_.spin_budget_us);
+            do {
+                WebSocketResult result = readOnce(buffer, size, readbytes);
+                if (!result || readbytes > 0) {
+                    return result;
                 }
-                #endif
-            }
+            } while (std::chrono::steady_clock::now() < deadline);
+        }
 
-            readbytes = ret;
-            return WebSocketResult(ResultCode::SUCCESS, "");
+        // TLS层可能已缓存了解密后的数据
+        if (!tls_.active() || !tls_.pending()) {
+            waitSocket(true, timeout_ms);
         }
+
+        return readOnce(buffer, size, readbytes);
     }
 
-    void close() noexcept {
-        if (ssl_) {
-            while ((int ret = SSL_shutdown(ssl)) < 0) {
-                int error = SSL_get_error(ssl_, ret);
-                if(error == SSL_ERROR_WANT_READ) {
-                    fd_set fds;
-                    FD_ZERO(&fds);
-                    FD_SET(SSL_get_fd(ssl_), &fds);
-                    select(SSL_get_fd(ssl_) + 1, &fds, NULL, NULL, NULL);
-                    continue;
-                } else if(error == SSL_ERROR_WANT_WRITE) {
-                    fd_set fds;
-                    FD_ZERO(&fds);
-                    FD_SET(SSL_get_fd(ssl_), &fds);
-                    select(SSL_get_fd(ssl_) + 1, NULL, &fds, NULL, NULL);
-                    continue;
-                }
+    // 设置忙轮询参数，在下次connect时生效
+    void setBusyPoll(const BusyPollOptions& options) noexcept { busy_poll_ = options; }
 
-                break;
-            }
+    // 设置socket调优参数，在下次connect时生效
+    void setSocketOptions(const SocketOptions& options) noexcept { socket_options_ = options; }
 
-            SSL_free(ssl_);
-            ssl_ = nullptr;
-        }
-        if (ssl_ctx_) {
-            SSL_CTX_free(ssl_ctx_);
-            ssl_ctx_ = nullptr;
+    void close() noexcept {
+        if (tls_.active()) {
+            TlsStatus status;
+            while ((status = tls_.shutdown()) == TlsStatus::WANT_READ || status == TlsStatus::WANT_WRITE) {
+                // 对端不响应时不无限等待
+                if (!waitSocket(status == TlsStatus::WANT_READ, 1000)) {
+                    break;
+                }
+            }
         }
+        tls_.reset();
         if (socket_ != INVALID_SOCKET) {
             #ifdef _WIN32
             closesocket(socket_);
@@ -522,22 +1145,158 @@ public:
     }
 
 private:
-    WebSocketResult connectInternal(struct addrinfo* result, bool use_ssl, int timeout_ms) noexcept {
+    // 非阻塞读取一次，无数据时readbytes为0
+    WebSocketResult readOnce(char* buffer, int size, size_t& readbytes) noexcept {
+        readbytes = 0;
+        if (tls_.active()) {
+            TlsStatus status = tls_.read(buffer, size, readbytes);
+            if (status == TlsStatus::PEER_CLOSED) {
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Connection closed by peer");
+            } else if (status == TlsStatus::FAILURE) {
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to recv: " + tls_.lastError());
+            }
+        } else {
+            int ret = ::recv(socket_, buffer, size, 0);
+            if(ret == 0) {
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Connection closed by peer");
+            } else if(ret == SOCKET_ERROR) {
+                #ifdef _WIN32
+                if(WSAGetLastError() != WSAEWOULDBLOCK) {
+                    return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to recv: " + std::to_string(WSAGetLastError()));
+                }
+                #else
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to recv: " + std::string(strerror(errno)));
+                }
+                #endif
+                return WebSocketResult(ResultCode::SUCCESS, "");
+            }
+
+            readbytes = ret;
+        }
+
+        #ifdef TCP_QUICKACK
+        // TCP_QUICKACK不是持久选项，每次读到数据后重新设置
+        if (busy_poll_.enabled && readbytes > 0) {
+            int one = 1;
+            setsockopt(socket_, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+        }
+        #endif
+
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+    // 应用socket调优参数，尽力而为，平台不支持或设置失败的选项忽略
+    void applySocketOptions(int family) noexcept {
+        const SocketOptions& o = socket_options_;
+        auto set = [this](int level, int name, int value) {
+            if (value >= 0) {
+                setsockopt(socket_, level, name, reinterpret_cast<const char*>(&value), sizeof(value));
+            }
+        };
+
+        set(SOL_SOCKET, SO_RCVBUF, o.recv_buffer);
+        set(SOL_SOCKET, SO_SNDBUF, o.send_buffer);
+        set(IPPROTO_TCP, TCP_NODELAY, o.tcp_nodelay);
+        set(SOL_SOCKET, SO_KEEPALIVE, o.keepalive);
+
+        #ifdef TCP_NOTSENT_LOWAT
+        set(IPPROTO_TCP, TCP_NOTSENT_LOWAT, o.notsent_lowat);
+        #endif
+        #ifdef TCP_USER_TIMEOUT
+        set(IPPROTO_TCP, TCP_USER_TIMEOUT, o.user_timeout_ms);
+        #endif
+        #ifdef TCP_KEEPIDLE
+        set(IPPROTO_TCP, TCP_KEEPIDLE, o.keepalive_idle_s);
+        #endif
+        #ifdef TCP_KEEPINTVL
+        set(IPPROTO_TCP, TCP_KEEPINTVL, o.keepalive_interval_s);
+        #endif
+        #ifdef TCP_KEEPCNT
+        set(IPPROTO_TCP, TCP_KEEPCNT, o.keepalive_count);
+        #endif
+
+        if (family == AF_INET6) {
+            #ifdef IPV6_TCLASS
+            set(IPPROTO_IPV6, IPV6_TCLASS, o.tos);
+            #endif
+        } else {
+            set(IPPROTO_IP, IP_TOS, o.tos);
+        }
+    }
+
+    // 忙轮询模式的socket选项，内核不支持的选项忽略
+    void applyBusyPollOptions() noexcept {
+        int one = 1;
+        setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+
+        #ifdef __linux__
+        int busy_poll_us = busy_poll_.socket_busy_poll_us;
+        if (busy_poll_us > 0) {
+            setsockopt(socket_, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us));
+        }
+        #ifdef SO_PREFER_BUSY_POLL
+        setsockopt(socket_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one));
+        #endif
+        #ifdef TCP_QUICKACK
+        setsockopt(socket_, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+        #endif
+        #endif
+    }
+
+    // 等待socket可读/可写，超时或出错返回false
+    bool waitSocket(bool for_read, int timeout_ms) noexcept {
+        return pollSocket(for_read ? POLLIN : POLLOUT, timeout_ms) > 0;
+    }
+
+    // 用poll等待，socket描述符不受FD_SETSIZE限制；被信号中断时按剩余时间重试，返回值同poll
+    int pollSocket(short events, int timeout_ms) noexcept {
+        pollfd pfd;
+        pfd.fd = socket_;
+        pfd.events = events;
+        pfd.revents = 0;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+        while (true) {
+            #ifdef _WIN32
+            return WSAPoll(&pfd, 1, timeout_ms);
+            #else
+            int ret = ::poll(&pfd, 1, timeout_ms);
+            if (ret >= 0 || errno != EINTR) {
+                return ret;
+            }
+            if (timeout_ms >= 0) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    return 0;
+                }
+                timeout_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+            }
+            #endif
+        }
+    }
+
+    WebSocketResult connectInternal(struct addrinfo* result, int timeout_ms) noexcept {
         // 创建socket
         socket_ = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
         if (socket_ == INVALID_SOCKET) {
             #ifdef _WIN32
-            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to create socket: " + std::string(WSAGetLastError()));
+            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to create socket: " + std::to_string(WSAGetLastError()));
             #else
             return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to create socket: " + std::string(strerror(errno)));
             #endif
         }
 
+        applySocketOptions(result->ai_family);
+        if (busy_poll_.enabled) {
+            applyBusyPollOptions();
+        }
+
         // 设置非阻塞模式
         #ifdef _WIN32
         u_long mode = 1;
         if (ioctlsocket(socket_, FIONBIO, &mode) == SOCKET_ERROR) {
-            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to set non-blocking mode: " + std::string(WSAGetLastError()));
+            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to set non-blocking mode: " + std::to_string(WSAGetLastError()));
         }
         #else
         int flags = fcntl(socket_, F_GETFL, 0);
@@ -551,11 +1310,11 @@ private:
         #endif
 
         // 连接
-        ret = ::connect(socket_, result->ai_addr, result->ai_addrlen);
+        int ret = ::connect(socket_, result->ai_addr, result->ai_addrlen);
         if (ret == SOCKET_ERROR) {
              #ifdef _WIN32
             if (WSAGetLastError() != WSAEWOULDBLOCK) {
-                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(WSAGetLastError()));
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::to_string(WSAGetLastError()));
             }
             #else
             if (errno != EINPROGRESS) {
@@ -563,92 +1322,53 @@ private:
             }
             #endif
 
-            fd_set setw, sete;
-            FD_ZERO(&setw);
-            FD_SET(socket_, &setw);
-            FD_ZERO(&sete);
-            FD_SET(socket_, &sete);
-
-            timeval time_out = {0};
-            time_out.tv_sec = timeout_ms / 1000;
-            time_out.tv_usec = (timeout_ms % 1000) * 1000;
-            
-            ret = select(socket_ + 1, NULL, &setw, &sete, &time_out);
+            // 连接失败时socket同样变为可写，需要检查SO_ERROR
+            ret = pollSocket(POLLOUT, timeout_ms);
             if (ret < 0) {
                 #ifdef _WIN32
-                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(WSAGetLastError()));
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::to_string(WSAGetLastError()));
+                #else
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(strerror(errno)));
+                #endif
+            } else if (ret == 0) {
+                return WebSocketResult(ResultCode::TIMEOUT,"Failed to connect: timeout");
+            }
+
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            ret = getsockopt(socket_, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&so_error), &len);
+            if (ret == SOCKET_ERROR) {
+                #ifdef _WIN32
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::to_string(WSAGetLastError()));
                 #else
                 return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(strerror(errno)));
                 #endif
-            } else if(ret == 0) {
-                //time out
-                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: timeout");
-            } else {
-                if (FD_ISSET(socket_, &sete)) {
-                    int so_error;
-                    socklen_t len = sizeof(so_error);
-                    ret = getsockopt(socket_, SOL_SOCKET, SO_ERROR, &so_error, &len);
-                    if(ret == SOCKET_ERROR) {
-                        #ifdef _WIN32
-                        return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(WSAGetLastError()));
-                        #else
-                        return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(strerror(errno)));
-                        #endif
-                    }
-                    
-                    #ifdef _WIN32
-                    WSASetLastError(so_error);
-                    return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(WSAGetLastError()));
-                    #else
-                    errno = so_error;
-                    return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(strerror(errno)));
-                    #endif
-                }
+            }
+            if (so_error != 0) {
+                #ifdef _WIN32
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::to_string(so_error));
+                #else
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect: " + std::string(strerror(so_error)));
+                #endif
             }
         }
 
         return WebSocketResult(ResultCode::SUCCESS, "");
     }
 
-    WebSocketResult setupSSL() noexcept {
-        SSL_library_init();
-        SSL_load_error_strings();
-        OpenSSL_add_all_algorithms();
-
-        ssl_ctx_ = SSL_CTX_new(TLS_client_method());
-        if (!ssl_ctx_) {
-            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to create SSL context: " + std::string(ERR_reason_error_string(ERR_get_error())));
-        }
-
-        ssl_ = SSL_new(ssl_ctx_);
-        if (!ssl_) {
-            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to create SSL: " + std::string(ERR_reason_error_string(ERR_get_error())));
-        }
-
-        if (SSL_set_fd(ssl_, socket_) != 1) {
-            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to set SSL socket: " + std::string(ERR_reason_error_string(ERR_get_error())));
-        }
-
-        if (SSL_set_tlsext_host_name(ssl_, host.c_str()) != 1) {
-            return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to set SSL host name: " + std::string(ERR_reason_error_string(ERR_get_error())));
+    WebSocketResult setupSSL(const std::string& host, int timeout_ms) noexcept {
+        WebSocketResult res = tls_.init(socket_, host);
+        if (!res) {
+            return res;
         }
 
-        while(SSL_connect(ssl_) <= 0) {
-            ret = SSL_get_error(ssl_,ret);
-            if(ret == SSL_ERROR_WANT_READ) {
-                fd_set fds;
-                FD_ZERO(&fds);
-                FD_SET(SSL_get_fd(ssl_), &fds);
-                select(SSL_get_fd(ssl_) + 1, &fds, NULL, NULL, NULL);
-                continue;
-            } else if(ret == SSL_ERROR_WANT_WRITE) {
-                fd_set fds;
-                FD_ZERO(&fds);
-                FD_SET(SSL_get_fd(ssl_), &fds);
-                select(SSL_get_fd(ssl_) + 1, NULL, &fds, NULL, NULL);
-                continue;
-            } else {
-                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect SSL: " + std::string(ERR_reason_error_string(ERR_get_error())));
+        TlsStatus status;
+        while ((status = tls_.handshake()) != TlsStatus::DONE) {
+            if (status != TlsStatus::WANT_READ && status != TlsStatus::WANT_WRITE) {
+                return WebSocketResult(ResultCode::CONNECTION_ERROR,"Failed to connect SSL: " + tls_.lastError());
+            }
+            if (!waitSocket(status == TlsStatus::WANT_READ, timeout_ms)) {
+                return WebSocketResult(ResultCode::TIMEOUT,"Failed to connect SSL: timeout");
             }
         }
 
@@ -657,321 +1377,870 @@ private:
 
 private:
     int socket_;
-    SSL_CTX* ssl_ctx_;
-    SSL* ssl_;
+    TlsLayer<Tls> tls_;
+    BusyPollOptions busy_poll_;
+    SocketOptions socket_options_;
 };
 
+// 支持ws://和wss://的连接
+typedef BasicNetworkConnection<true> NetworkConnection;
+// 只支持ws://，不链接TLS代码
+typedef BasicNetworkConnection<false> PlainConnection;
+
 #ifndef _WIN32
 #undef INVALID_SOCKET
 #undef SOCKET_ERROR
 #endif
 
 
-#ifdef USE_ZLIB
-// 压缩/解压类
-class Compression {
-public:
-    Compression(int level = 6) : level_(level) {
-        initCompressor();
-        initDecompressor();
-    }
-
-    ~Compression() {
-        deflateEnd(&compressor_);
-        inflateEnd(&decompressor_);
-    }
-
-    WebSocketResult compress(const std::string& data,std::string& result) noexcept {
-        if (data.empty()) {
-            result = data;
-            return WebSocketResult(ResultCode::SUCCESS, "");
-        }
+// permessage-deflate参数(RFC 7692)，client_*约束客户端发送方向的压缩，server_*约束接收方向
+struct DeflateParams {
+    bool client_no_context_takeover = false;
+    bool server_no_context_takeover = false;
+    int client_max_window_bits = 15;
+    int server_max_window_bits = 15;
+};
 
-        result.clear();
-        compressor_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.c_str()));
-        compressor_.avail_in = data.length();
+#ifdef USE_ZLIB
+#ifdef USE_ZLIB_NG
+// zlib-ng原生接口，函数带zng_前缀
+typedef zng_stream ZStream;
+#define WEBSOCKET_ZLIB(fn) zng_##fn
+#else
+typedef z_stream ZStream;
+#define WEBSOCKET_ZLIB(fn) fn
+#endif
 
-        do {
-            char buffer[1024];
-            compressor_.next_out = reinterpret_cast<Bytef*>(buffer);
-            compressor_.avail_out = sizeof(buffer);
+// 压缩器，持有一个方向的压缩上下文
+class Deflater {
+public:
+    virtual ~Deflater() {}
+    // 压缩一条消息，输出已按RFC 7692去掉 00 00 ff ff 结尾
+    virtual WebSocketResult compress(const char* data, size_t len, std::string& out) = 0;
+    // 清空上下文，no_context_takeover模式下在消息之间调用
+    virtual bool reset() = 0;
+    // 预置字典，在创建或reset之后、压缩第一条消息之前调用，不支持时返回false
+    virtual bool setDictionary(const char* data, size_t len) = 0;
+};
 
-            int ret = deflate(&compressor_, Z_SYNC_FLUSH);
-            if(ret == Z_STREAM_END) {
-                break;
-            } else if(ret != Z_OK) {
-                return WebSocketResult(ResultCode::COMPRESSION_ERROR,"Failed to compress: " + std::string(zlibError(ret)));
-            }
+// 解压器，输入为去掉 00 00 ff ff 结尾的消息
+class Inflater {
+public:
+    virtual ~Inflater() {}
+    // 输出超过max_size时返回BUFFER_OVERFLOW，输出缓冲区随上限封顶，0表示不限制
+    virtual WebSocketResult decompress(const char* data, size_t len, std::string& out, size_t max_size) = 0;
+    virtual bool reset() = 0;
+    virtual bool setDictionary(const char* data, size_t len) = 0;
+};
 
-            size_t compressed_size = sizeof(buffer) - compressor_.avail_out;
-            result.append(buffer, compressed_size);
-        } while (compressor_.avail_out == 0);
+// 压缩后端，编译时选择: 默认zlib，定义USE_ZLIB_NG使用zlib-ng，
+// 定义USE_LIBDEFLATE时no_context_takeover模式改用libdeflate整条消息压缩/解压
+class CompressionBackend {
+public:
+    virtual ~CompressionBackend() {}
+    virtual const char* name() const = 0;
+    // 创建失败时返回空指针
+    virtual std::unique_ptr<Deflater> createDeflater(int level, int window_bits, int mem_level) const = 0;
+    virtual std::unique_ptr<Inflater> createInflater(int window_bits) const = 0;
+
+    // 上下文接管模式使用的流式后端
+    static const CompressionBackend& streaming();
+    // no_context_takeover模式使用的后端
+    static const CompressionBackend& perMessage(int window_bits);
+};
 
-        return WebSocketResult(ResultCode::SUCCESS, "");
+// zlib/zlib-ng流式压缩，输出直接写入按deflateBound预留的缓冲区
+class ZlibDeflater : public Deflater {
+public:
+    ZlibDeflater() : initialized_(false) {
+        std::memset(&stream_, 0, sizeof(stream_));
     }
 
-    WebSocketResult decompress(const std::string& data,std::string& result)  noexcept {
-        if (data.empty()) {
-            result = data;
-            return WebSocketResult(ResultCode::SUCCESS, "");
+    ~ZlibDeflater() override {
+        if (initialized_) {
+            WEBSOCKET_ZLIB(deflateEnd)(&stream_);
         }
+    }
 
-        result.clear();
-        decompressor_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.c_str()));
-        decompressor_.avail_in = data.length();
+    bool init(int level, int window_bits, int mem_level) {
+        initialized_ = WEBSOCKET_ZLIB(deflateInit2)(&stream_, level, Z_DEFLATED, -window_bits, mem_level, Z_DEFAULT_STRATEGY) == Z_OK;
+        return initialized_;
+    }
 
-        do {
-            char buffer[1024];
-            decompressor_.next_out = reinterpret_cast<Bytef*>(buffer);
-            decompressor_.avail_out = sizeof(buffer);
+    WebSocketResult compress(const char* data, size_t len, std::string& out) override {
+        // deflateBound不含SYNC_FLUSH追加的空块，多预留一些
+        out.resize(WEBSOCKET_ZLIB(deflateBound)(&stream_, len) + 16);
+        stream_.next_in = const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(data));
+        stream_.avail_in = len;
+
+        size_t produced = 0;
+        for (;;) {
+            stream_.next_out = reinterpret_cast<unsigned char*>(&out[produced]);
+            stream_.avail_out = out.size() - produced;
+
+            int ret = WEBSOCKET_ZLIB(deflate)(&stream_, Z_SYNC_FLUSH);
+            if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                out.clear();
+                return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Failed to compress: " + std::string(WEBSOCKET_ZLIB(zError)(ret)));
+            }
 
-            int ret = inflate(&decompressor_, Z_SYNC_FLUSH);
-            if(ret == Z_STREAM_END) {
+            produced = out.size() - stream_.avail_out;
+            if (stream_.avail_out != 0) {
                 break;
-            } else if(ret != Z_OK) {
-                return WebSocketResult(ResultCode::COMPRESSION_ERROR,"Failed to decompress: " + std::string(zlibError(ret)));
             }
+            out.resize(out.size() * 2);
+        }
 
-            size_t decompressed_size = sizeof(buffer) - decompressor_.avail_out;
-            result.append(buffer, decompressed_size);
-        } while (decompressor_.avail_out == 0);
-
+        if (produced >= 4 && std::memcmp(&out[produced - 4], "\x00\x00\xff\xff", 4) == 0) {
+            produced -= 4;
+        }
+        out.resize(produced);
         return WebSocketResult(ResultCode::SUCCESS, "");
     }
 
-private:
-    void initCompressor() {
-        compressor_.zalloc = Z_NULL;
-        compressor_.zfree = Z_NULL;
-        compressor_.opaque = Z_NULL;
-        deflateInit2(&compressor_, level_, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    bool reset() override {
+        return WEBSOCKET_ZLIB(deflateReset)(&stream_) == Z_OK;
     }
 
-    void initDecompressor() {
-        decompressor_.zalloc = Z_NULL;
-        decompressor_.zfree = Z_NULL;
-        decompressor_.opaque = Z_NULL;
-        inflateInit2(&decompressor_, -15);
+    bool setDictionary(const char* data, size_t len) override {
+        return WEBSOCKET_ZLIB(deflateSetDictionary)(&stream_, reinterpret_cast<const unsigned char*>(data), len) == Z_OK;
     }
 
-    int level_;
-    z_stream compressor_;
-    z_stream decompressor_;
+private:
+    ZStream stream_;
+    bool initialized_;
 };
-#endif
 
-// WebSocket帧类
-class WebSocketFrame {
+class ZlibInflater : public Inflater {
 public:
-    WebSocketFrame() : fin_(true), opcode_(0), masked_(false), payload_length_(0) {}
-
-    void setFin(bool fin) { fin_ = fin; }
-    void setOpcode(uint8_t opcode) { opcode_ = opcode; }
-    void setMasked(bool masked) { masked_ = masked; }
-    void setPayload(const std::string& payload) { payload_ = payload; payload_length_ = payload.length(); }
-    void setMaskKey(const std::string& key) { mask_key_ = key; }
-
-    bool isFin() const { return fin_; }
-    uint8_t getOpcode() const { return opcode_; }
-    bool isMasked() const { return masked_; }
-    const std::string& getPayload() const { return payload_; }
-    size_t getPayloadLength() const { return payload_length_; }
-
-    std::string serialize() const {
-        std::string frame;
-        
-        // 第一个字节
-        uint8_t first_byte = (fin_ ? 0x80 : 0x00) | (opcode_ & 0x0F);
-        frame.push_back(first_byte);
+    ZlibInflater() : initialized_(false) {
+        std::memset(&stream_, 0, sizeof(stream_));
+    }
 
-        // 第二个字节
-        uint8_t second_byte = masked_ ? 0x80 : 0x00;
-        if (payload_length_ < 126) {
-            second_byte |= payload_length_;
-            frame.push_back(second_byte);
-        } else if (payload_length_ < 65536) {
-            second_byte |= 126;
-            frame.push_back(second_byte);
-            frame.push_back((payload_length_ >> 8) & 0xFF);
-            frame.push_back(payload_length_ & 0xFF);
-        } else {
-            second_byte |= 127;
-            frame.push_back(second_byte);
-            for (int i = 7; i >= 0; --i) {
-                frame.push_back((payload_length_ >> (i * 8)) & 0xFF);
-            }
+    ~ZlibInflater() override {
+        if (initialized_) {
+            WEBSOCKET_ZLIB(inflateEnd)(&stream_);
         }
+    }
 
-        // 掩码密钥
-        if (masked_) {
-            frame.append(mask_key_);
-        }
+    bool init(int window_bits) {
+        initialized_ = WEBSOCKET_ZLIB(inflateInit2)(&stream_, -window_bits) == Z_OK;
+        return initialized_;
+    }
 
-        // 载荷数据
-        if (!payload_.empty()) {
-            if (masked_) {
-                std::string masked_payload = payload_;
-                for (size_t i = 0; i < payload_.length(); ++i) {
-                    masked_payload[i] = payload_[i] ^ mask_key_[i % 4];
+    WebSocketResult decompress(const char* data, size_t len, std::string& out, size_t max_size) override {
+        static const char tail[4] = { '\x00', '\x00', '\xff', '\xff' };
+
+        // 先按4倍压缩率预留，不够时翻倍，避免小块反复append；有上限时最多多分配一个字节用于发现超限
+        size_t limit = max_size > 0 ? max_size + 1 : std::numeric_limits<size_t>::max();
+        out.resize(std::min(std::max<size_t>(len * 4, 1024), limit));
+        size_t produced = 0;
+        for (int pass = 0; pass < 2; ++pass) {
+            stream_.next_in = const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(pass == 0 ? data : tail));
+            stream_.avail_in = (pass == 0) ? len : sizeof(tail);
+
+            for (;;) {
+                if (produced == out.size()) {
+                    if (produced >= limit) {
+                        out.clear();
+                        return WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Decompressed message too large");
+                    }
+                    out.resize(std::min(out.size() * 2, limit));
+                }
+                stream_.next_out = reinterpret_cast<unsigned char*>(&out[produced]);
+                stream_.avail_out = out.size() - produced;
+
+                int ret = WEBSOCKET_ZLIB(inflate)(&stream_, Z_SYNC_FLUSH);
+                produced = out.size() - stream_.avail_out;
+                if (produced >= limit) {
+                    out.clear();
+                    return WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Decompressed message too large");
+                }
+                if (ret == Z_STREAM_END) {
+                    out.resize(produced);
+                    return WebSocketResult(ResultCode::SUCCESS, "");
+                } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                    out.clear();
+                    return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Failed to decompress: " + std::string(WEBSOCKET_ZLIB(zError)(ret)));
+                }
+
+                // 输出区没写满说明输入已经消耗完
+                if (stream_.avail_out != 0) {
+                    break;
                 }
-                frame.append(masked_payload);
-            } else {
-                frame.append(payload_);
             }
         }
 
-        return frame;
+        out.resize(produced);
+        return WebSocketResult(ResultCode::SUCCESS, "");
     }
 
-    static WebSocketResult parse(const std::string& data,WebSocketFrame& frame) noexcept {
-        size_t pos = 0;
+    bool reset() override {
+        return WEBSOCKET_ZLIB(inflateReset)(&stream_) == Z_OK;
+    }
 
-        if (data.length() < 2) {
-            return WebSocketResult(ResultCode::FRAME_ERROR, "Frame too short");
-        }
+    // raw inflate可以在解压前直接设置字典
+    bool setDictionary(const char* data, size_t len) override {
+        return WEBSOCKET_ZLIB(inflateSetDictionary)(&stream_, reinterpret_cast<const unsigned char*>(data), len) == Z_OK;
+    }
 
-        // 解析第一个字节
-        uint8_t first_byte = data[pos++];
-        frame.fin_ = (first_byte & 0x80) != 0;
-        frame.opcode_ = first_byte & 0x0F;
+private:
+    ZStream stream_;
+    bool initialized_;
+};
 
-        // 解析第二个字节
-        uint8_t second_byte = data[pos++];
-        frame.masked_ = (second_byte & 0x80) != 0;
-        uint64_t payload_length = second_byte & 0x7F;
+class ZlibBackend : public CompressionBackend {
+public:
+    const char* name() const override {
+        #ifdef USE_ZLIB_NG
+        return "zlib-ng";
+        #else
+        return "zlib";
+        #endif
+    }
 
-        if (payload_length == 126) {
-            if (data.length() < pos + 2) {
-                return WebSocketResult(ResultCode::FRAME_ERROR, "Frame too short for 16-bit length");
-            }
-            payload_length = (static_cast<uint8_t>(data[pos]) << 8) | static_cast<uint8_t>(data[pos + 1]);
-            pos += 2;
-        } else if (payload_length == 127) {
-            if (data.length() < pos + 8) {
-                return WebSocketResult(ResultCode::FRAME_ERROR, "Frame too short for 64-bit length");
-            }
-            payload_length = 0;
-            for (int i = 0; i < 8; ++i) {
-                payload_length = (payload_length << 8) | static_cast<uint8_t>(data[pos + i]);
-            }
-            pos += 8;
+    std::unique_ptr<Deflater> createDeflater(int level, int window_bits, int mem_level) const override {
+        std::unique_ptr<ZlibDeflater> deflater(new ZlibDeflater());
+        if (!deflater->init(level, window_bits, mem_level)) {
+            return nullptr;
         }
+        return std::unique_ptr<Deflater>(deflater.release());
+    }
 
-        // 解析掩码密钥
-        if (frame.masked_) {
-            if (data.length() < pos + 4) {
-                return WebSocketResult(ResultCode::FRAME_ERROR, "Frame too short for mask key");
-            }
-            frame.mask_key_ = data.substr(pos, 4);
-            pos += 4;
+    std::unique_ptr<Inflater> createInflater(int window_bits) const override {
+        std::unique_ptr<ZlibInflater> inflater(new ZlibInflater());
+        if (!inflater->init(window_bits)) {
+            return nullptr;
         }
+        return std::unique_ptr<Inflater>(inflater.release());
+    }
+};
 
-        // 解析载荷数据
-        if (data.length() < pos + payload_length) {
-            return WebSocketResult(ResultCode::FRAME_ERROR, "Frame too short for payload");
-        }
+#ifdef USE_LIBDEFLATE
+// libdeflate一次压缩整条消息，输出以BFINAL块结束，按RFC 7692只需补一个0字节
+class LibdeflateDeflater : public Deflater {
+public:
+    explicit LibdeflateDeflater(int level) : compressor_(libdeflate_alloc_compressor(level)) {}
 
-        std::string payload = data.substr(pos, payload_length);
-        if (frame.masked_) {
-            for (size_t i = 0; i < payload.length(); ++i) {
-                payload[i] = payload[i] ^ frame.mask_key_[i % 4];
-            }
+    ~LibdeflateDeflater() override {
+        if (compressor_) {
+            libdeflate_free_compressor(compressor_);
         }
+    }
 
-        frame.payload_ = payload;
-        frame.payload_length_ = payload.length();
+    bool valid() const { return compressor_ != nullptr; }
 
+    WebSocketResult compress(const char* data, size_t len, std::string& out) override {
+        out.resize(libdeflate_deflate_compress_bound(compressor_, len) + 1);
+        size_t produced = libdeflate_deflate_compress(compressor_, data, len, &out[0], out.size() - 1);
+        if (produced == 0) {
+            out.clear();
+            return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Failed to compress");
+        }
+        out[produced] = '\0';
+        out.resize(produced + 1);
         return WebSocketResult(ResultCode::SUCCESS, "");
     }
 
+    bool reset() override { return true; }
+    bool setDictionary(const char*, size_t) override { return false; }
+
 private:
-    bool fin_;
-    uint8_t opcode_;
-    bool masked_;
-    std::string mask_key_;
-    std::string payload_;
-    size_t payload_length_;
+    libdeflate_compressor* compressor_;
 };
 
-// WebSocket握手类
-class WebSocketHandshake {
+class LibdeflateInflater : public Inflater {
 public:
-    static WebSocketResult createHandshakeRequest(const URL& url, const WebSocketConfig& config, std::string& request, std::string& accept_key) noexcept {
-        std::string key = Utils::generateRandomString(16);
-        accept_key = Utils::base64Encode(Utils::sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+    LibdeflateInflater() : decompressor_(libdeflate_alloc_decompressor()) {}
 
-        request.clear();
-        request = "GET " + url.path();
-        if (!url.query().empty()) {
-            request += "?" + url.query();
+    ~LibdeflateInflater() override {
+        if (decompressor_) {
+            libdeflate_free_decompressor(decompressor_);
         }
-        request += " HTTP/1.1\r\n";
-        request += "Host: " + url.host();
-        if (url.port() != (url.scheme() == "wss" ? 443 : 80)) {
-            request += ":" + std::to_string(url.port());
+    }
+
+    bool valid() const { return decompressor_ != nullptr; }
+
+    WebSocketResult decompress(const char* data, size_t len, std::string& out, size_t max_size) override {
+        // libdeflate要求完整的deflate流: 补回 00 00 ff ff，再追加一个空的BFINAL块
+        static const char tail[6] = { '\x00', '\x00', '\xff', '\xff', '\x03', '\x00' };
+        input_.assign(data, len);
+        input_.append(tail, sizeof(tail));
+
+        // 输出区达到max_size仍不够即为超限
+        size_t limit = max_size > 0 ? max_size : std::numeric_limits<size_t>::max();
+        out.resize(std::min(std::max<size_t>(len * 4, 1024), limit));
+        for (;;) {
+            size_t in_used = 0;
+            size_t produced = 0;
+            libdeflate_result ret = libdeflate_deflate_decompress_ex(decompressor_, input_.data(), input_.size(),
+                                                                     &out[0], out.size(), &in_used, &produced);
+            if (ret == LIBDEFLATE_SUCCESS) {
+                out.resize(produced);
+                return WebSocketResult(ResultCode::SUCCESS, "");
+            } else if (ret != LIBDEFLATE_INSUFFICIENT_SPACE) {
+                out.clear();
+                return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Failed to decompress: invalid deflate data");
+            } else if (out.size() >= limit) {
+                out.clear();
+                return WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Decompressed message too large");
+            }
+            out.resize(std::min(out.size() * 2, limit));
         }
-        request += "\r\n";
-        request += "Upgrade: websocket\r\n";
-        request += "Connection: Upgrade\r\n";
-        request += "Sec-WebSocket-Key: " + Utils::base64Encode(key) + "\r\n";
-        request += "Sec-WebSocket-Version: 13\r\n";
+    }
 
-        // 添加自定义头部
-        for (const auto& header : config.getHeaders()) {
-            request += header.first + ": " + header.second + "\r\n";
+    bool reset() override { return true; }
+    bool setDictionary(const char*, size_t) override { return false; }
+
+private:
+    libdeflate_decompressor* decompressor_;
+    std::string input_;
+};
+
+class LibdeflateBackend : public CompressionBackend {
+public:
+    const char* name() const override { return "libdeflate"; }
+
+    std::unique_ptr<Deflater> createDeflater(int level, int /*window_bits*/, int /*mem_level*/) const override {
+        std::unique_ptr<LibdeflateDeflater> deflater(new LibdeflateDeflater(level));
+        if (!deflater->valid()) {
+            return nullptr;
         }
+        return std::unique_ptr<Deflater>(deflater.release());
+    }
 
-        // 添加扩展
-        if (!config.getExtensions().empty()) {
-            std::string extensions;
-            for (const auto& ext : config.getExtensions()) {
-                if (!extensions.empty()) extensions += ", ";
-                extensions += ext.first;
-                if (!ext.second.empty()) {
-                    extensions += "; " + ext.second;
+    std::unique_ptr<Inflater> createInflater(int /*window_bits*/) const override {
+        std::unique_ptr<LibdeflateInflater> inflater(new LibdeflateInflater());
+        if (!inflater->valid()) {
+            return nullptr;
+        }
+        return std::unique_ptr<Inflater>(inflater.release());
+    }
+};
+#endif
+
+inline const CompressionBackend& CompressionBackend::streaming() {
+    static ZlibBackend backend;
+    return backend;
+}
+
+inline const CompressionBackend& CompressionBackend::perMessage(int window_bits) {
+    #ifdef USE_LIBDEFLATE
+    // libdeflate固定使用32KB窗口，协商了更小的窗口时仍用流式后端
+    if (window_bits == 15) {
+        static LibdeflateBackend backend;
+        return backend;
+    }
+    #else
+    (void)window_bits;
+    #endif
+    return streaming();
+}
+
+// 压缩上下文池，no_context_takeover模式下每条消息独立压缩，
+// 各连接从池中借用上下文，用完reset后归还，空闲连接不占用压缩状态
+class CompressionContextPool {
+public:
+    static CompressionContextPool& instance() {
+        static CompressionContextPool pool;
+        return pool;
+    }
+
+    // 每种参数组合最多缓存的空闲上下文数，超出的在归还时释放
+    void setMaxIdle(size_t max_idle) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        max_idle_ = max_idle;
+    }
+
+    // 使用预置字典时需要支持字典的流式后端，与不带字典的上下文分开缓存
+    std::unique_ptr<Deflater> acquireDeflate(int level, int window_bits, int mem_level, bool dictionary = false) {
+        int key = deflateKey(level, window_bits, mem_level, dictionary);
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = deflate_idle_.find(key);
+            if (it != deflate_idle_.end() && !it->second.empty()) {
+                std::unique_ptr<Deflater> deflater = std::move(it->second.back());
+                it->second.pop_back();
+                return deflater;
+            }
+        }
+        const CompressionBackend& backend = dictionary ? CompressionBackend::streaming() : CompressionBackend::perMessage(window_bits);
+        return backend.createDeflater(level, window_bits, mem_level);
+    }
+
+    void releaseDeflate(std::unique_ptr<Deflater> deflater, int level, int window_bits, int mem_level, bool dictionary = false) {
+        if (!deflater || !deflater->reset()) return;
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<std::unique_ptr<Deflater>>& idle = deflate_idle_[deflateKey(level, window_bits, mem_level, dictionary)];
+        if (idle.size() < max_idle_) {
+            idle.push_back(std::move(deflater));
+        }
+    }
+
+    std::unique_ptr<Inflater> acquireInflate(int window_bits, bool dictionary = false) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            auto it = inflate_idle_.find(inflateKey(window_bits, dictionary));
+            if (it != inflate_idle_.end() && !it->second.empty()) {
+                std::unique_ptr<Inflater> inflater = std::move(it->second.back());
+                it->second.pop_back();
+                return inflater;
+            }
+        }
+        const CompressionBackend& backend = dictionary ? CompressionBackend::streaming() : CompressionBackend::perMessage(window_bits);
+        return backend.createInflater(window_bits);
+    }
+
+    void releaseInflate(std::unique_ptr<Inflater> inflater, int window_bits, bool dictionary = false) {
+        if (!inflater || !inflater->reset()) return;
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<std::unique_ptr<Inflater>>& idle = inflate_idle_[inflateKey(window_bits, dictionary)];
+        if (idle.size() < max_idle_) {
+            idle.push_back(std::move(inflater));
+        }
+    }
+
+private:
+    CompressionContextPool() : max_idle_(64) {}
+
+    static int deflateKey(int level, int window_bits, int mem_level, bool dictionary) {
+        return level | (window_bits << 8) | (mem_level << 16) | (dictionary ? 1 << 24 : 0);
+    }
+
+    static int inflateKey(int window_bits, bool dictionary) {
+        return window_bits | (dictionary ? 1 << 8 : 0);
+    }
+
+    std::mutex mtx_;
+    size_t max_idle_;
+    std::map<int, std::vector<std::unique_ptr<Deflater>>> deflate_idle_;
+    std::map<int, std::vector<std::unique_ptr<Inflater>>> inflate_idle_;
+};
+
+// 压缩/解压类 (permessage-deflate)
+// 上下文接管模式下每个连接独占压缩状态，首次使用时才分配，
+// window_bits/mem_level决定状态大小: deflate约 (1 << (window_bits + 2)) + (1 << (mem_level + 9)) 字节，
+// inflate约 (1 << window_bits) + 7KB；no_context_takeover模式下每条消息从共享池借用上下文。
+// 设置预置字典后，上下文接管模式在创建上下文时预置一次，no_context_takeover模式每条消息都预置
+class Compression {
+public:
+    Compression(int level = 6, int window_bits = 15, int mem_level = 8, bool context_takeover = true,
+                const std::string& dictionary = std::string()) {
+        configure(level, window_bits, mem_level, context_takeover, dictionary);
+    }
+
+    // 修改参数并丢弃现有上下文，两个方向使用相同参数，dictionary为空表示不使用预置字典
+    void configure(int level, int window_bits, int mem_level, bool context_takeover,
+                   const std::string& dictionary = std::string()) {
+        DeflateParams params;
+        params.client_no_context_takeover = params.server_no_context_takeover = !context_takeover;
+        params.client_max_window_bits = params.server_max_window_bits = window_bits;
+        configure(level, mem_level, params, dictionary);
+    }
+
+    // 按握手协商结果配置，新连接建立时调用：压缩用client_*参数，解压用server_*参数
+    void configure(int level, int mem_level, const DeflateParams& params, const std::string& dictionary = std::string()) {
+        reset();
+        level_ = level;
+        // zlib的raw deflate不支持8位窗口，按9位处理
+        deflate_window_bits_ = std::max(9, std::min(15, params.client_max_window_bits));
+        inflate_window_bits_ = std::max(9, std::min(15, params.server_max_window_bits));
+        mem_level_ = std::max(1, std::min(9, mem_level));
+        deflate_takeover_ = !params.client_no_context_takeover;
+        inflate_takeover_ = !params.server_no_context_takeover;
+        // 字典只有最后一个窗口大小的内容有效，按较大的窗口截取，压缩方向再按自己的窗口截取
+        size_t window = static_cast<size_t>(1) << std::max(deflate_window_bits_, inflate_window_bits_);
+        dictionary_ = dictionary.size() > window ? dictionary.substr(dictionary.size() - window) : dictionary;
+    }
+
+    // 释放独占的上下文
+    void reset() {
+        compressor_.reset();
+        decompressor_.reset();
+    }
+
+    // 解压后的消息上限，超出时decompress返回BUFFER_OVERFLOW，0表示不限制
+    void setMaxMessageSize(size_t size) { max_message_size_ = size; }
+
+    WebSocketResult compress(const std::string& data,std::string& result) noexcept {
+        if (data.empty()) {
+            result = data;
+            return WebSocketResult(ResultCode::SUCCESS, "");
+        }
+
+        size_t window = static_cast<size_t>(1) << deflate_window_bits_;
+        size_t dictionary_size = std::min(dictionary_.size(), window);
+        const char* dictionary = dictionary_.data() + dictionary_.size() - dictionary_size;
+
+        if (deflate_takeover_) {
+            if (!compressor_) {
+                compressor_ = CompressionBackend::streaming().createDeflater(level_, deflate_window_bits_, mem_level_);
+                if (!compressor_ || (dictionary_size > 0 && !compressor_->setDictionary(dictionary, dictionary_size))) {
+                    compressor_.reset();
+                    return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Failed to initialize compressor");
+                }
+            }
+            return compressor_->compress(data.data(), data.size(), result);
+        }
+
+        bool with_dictionary = dictionary_size > 0;
+        CompressionContextPool& pool = CompressionContextPool::instance();
+        std::unique_ptr<Deflater> deflater = pool.acquireDeflate(level_, deflate_window_bits_, mem_level_, with_dictionary);
+        if (!deflater || (with_dictionary && !deflater->setDictionary(dictionary, dictionary_size))) {
+            return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Failed to initialize compressor");
+        }
+        WebSocketResult res = deflater->compress(data.data(), data.size(), result);
+        pool.releaseDeflate(std::move(deflater), level_, deflate_window_bits_, mem_level_, with_dictionary);
+        return res;
+    }
+
+    WebSocketResult decompress(const std::string& data,std::string& result)  noexcept {
+        if (data.empty()) {
+            result = data;
+            return WebSocketResult(ResultCode::SUCCESS, "");
+        }
+
+        if (inflate_takeover_) {
+            if (!decompressor_) {
+                decompressor_ = CompressionBackend::streaming().createInflater(inflate_window_bits_);
+                if (!decompressor_ || (!dictionary_.empty() && !decompressor_->setDictionary(dictionary_.data(), dictionary_.size()))) {
+                    decompressor_.reset();
+                    return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Failed to initialize decompressor");
+                }
+            }
+            return decompressor_->decompress(data.data(), data.size(), result, max_message_size_);
+        }
+
+        bool with_dictionary = !dictionary_.empty();
+        CompressionContextPool& pool = CompressionContextPool::instance();
+        std::unique_ptr<Inflater> inflater = pool.acquireInflate(inflate_window_bits_, with_dictionary);
+        if (!inflater || (with_dictionary && !inflater->setDictionary(dictionary_.data(), dictionary_.size()))) {
+            return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Failed to initialize decompressor");
+        }
+        WebSocketResult res = inflater->decompress(data.data(), data.size(), result, max_message_size_);
+        pool.releaseInflate(std::move(inflater), inflate_window_bits_, with_dictionary);
+        return res;
+    }
+
+private:
+    int level_;
+    int deflate_window_bits_;
+    int inflate_window_bits_;
+    int mem_level_;
+    bool deflate_takeover_;
+    bool inflate_takeover_;
+    size_t max_message_size_ = 0;
+    std::string dictionary_;
+    std::unique_ptr<Deflater> compressor_;      // 仅上下文接管模式使用
+    std::unique_ptr<Inflater> decompressor_;
+};
+#endif
+
+// WebSocket帧类
+class WebSocketFrame {
+public:
+    WebSocketFrame() : fin_(true), rsv_(0), opcode_(0), masked_(false), payload_length_(0) {}
+
+    void setFin(bool fin) { fin_ = fin; }
+    // RSV1-RSV3位(0-7，RSV1为最高位)，permessage-deflate用RSV1标记压缩消息的第一帧
+    void setRsv(uint8_t rsv) { rsv_ = rsv & 0x07; }
+    void setRsv1(bool rsv1) { rsv_ = rsv1 ? (rsv_ | 0x04) : (rsv_ & 0x03); }
+    void setOpcode(uint8_t opcode) { opcode_ = opcode; }
+    void setMasked(bool masked) { masked_ = masked; }
+    void setPayload(const std::string& payload) { payload_ = payload; payload_length_ = payload.length(); }
+    void setMaskKey(const std::string& key) { mask_key_ = key; }
+
+    bool isFin() const { return fin_; }
+    uint8_t getRsv() const { return rsv_; }
+    bool isRsv1() const { return (rsv_ & 0x04) != 0; }
+    uint8_t getOpcode() const { return opcode_; }
+    bool isMasked() const { return masked_; }
+    const std::string& getPayload() const { return payload_; }
+    size_t getPayloadLength() const { return payload_length_; }
+
+    std::string serialize() const {
+        std::string frame;
+        
+        // 第一个字节
+        uint8_t first_byte = (fin_ ? 0x80 : 0x00) | (rsv_ << 4) | (opcode_ & 0x0F);
+        frame.push_back(first_byte);
+
+        // 第二个字节
+        uint8_t second_byte = masked_ ? 0x80 : 0x00;
+        if (payload_length_ < 126) {
+            second_byte |= payload_length_;
+            frame.push_back(second_byte);
+        } else if (payload_length_ < 65536) {
+            second_byte |= 126;
+            frame.push_back(second_byte);
+            frame.push_back((payload_length_ >> 8) & 0xFF);
+            frame.push_back(payload_length_ & 0xFF);
+        } else {
+            second_byte |= 127;
+            frame.push_back(second_byte);
+            for (int i = 7; i >= 0; --i) {
+                frame.push_back((payload_length_ >> (i * 8)) & 0xFF);
+            }
+        }
+
+        // 掩码密钥
+        if (masked_) {
+            frame.append(mask_key_);
+        }
+
+        // 载荷数据
+        if (!payload_.empty()) {
+            if (masked_) {
+                std::string masked_payload = payload_;
+                for (size_t i = 0; i < payload_.length(); ++i) {
+                    masked_payload[i] = payload_[i] ^ mask_key_[i % 4];
                 }
+                frame.append(masked_payload);
+            } else {
+                frame.append(payload_);
+            }
+        }
+
+        return frame;
+    }
+
+    static WebSocketResult parse(const std::string& data,WebSocketFrame& frame) noexcept {
+        size_t consumed = 0;
+        WebSocketResult res = parse(data.data(), data.length(), frame, consumed);
+        if (!res) {
+            return res;
+        }
+        if (consumed == 0) {
+            return WebSocketResult(ResultCode::FRAME_ERROR, "Frame too short");
+        }
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+    // 返回完整帧(头部加载荷)的长度，头部不完整时返回0
+    static size_t frameSize(const char* data, size_t len, uint64_t& payload_length) noexcept {
+        if (len < 2) return 0;
+
+        uint8_t second_byte = static_cast<uint8_t>(data[1]);
+        size_t header_length = 2;
+        payload_length = second_byte & 0x7F;
+        if (payload_length == 126) {
+            header_length += 2;
+        } else if (payload_length == 127) {
+            header_length += 8;
+        }
+        if (second_byte & 0x80) {
+            header_length += 4;
+        }
+        if (len < header_length) return 0;
+
+        if (payload_length == 126) {
+            payload_length = (static_cast<uint8_t>(data[2]) << 8) | static_cast<uint8_t>(data[3]);
+        } else if (payload_length == 127) {
+            payload_length = 0;
+            for (int i = 0; i < 8; ++i) {
+                payload_length = (payload_length << 8) | static_cast<uint8_t>(data[2 + i]);
+            }
+        }
+        return header_length + payload_length;
+    }
+
+    // 从缓冲区解析一帧，数据不足一帧时consumed为0
+    static WebSocketResult parse(const char* data, size_t len, WebSocketFrame& frame, size_t& consumed) noexcept {
+        consumed = 0;
+
+        uint64_t payload_length = 0;
+        size_t frame_size = frameSize(data, len, payload_length);
+        if (frame_size == 0 || len < frame_size) {
+            return WebSocketResult(ResultCode::SUCCESS, "");
+        }
+        if (payload_length >> 63) {
+            return WebSocketResult(ResultCode::FRAME_ERROR, "Invalid 64-bit payload length");
+        }
+
+        // 解析第一个字节
+        uint8_t first_byte = static_cast<uint8_t>(data[0]);
+        frame.fin_ = (first_byte & 0x80) != 0;
+        frame.rsv_ = (first_byte >> 4) & 0x07;
+        frame.opcode_ = first_byte & 0x0F;
+
+        // 解析掩码密钥
+        frame.masked_ = (static_cast<uint8_t>(data[1]) & 0x80) != 0;
+        size_t pos = frame_size - payload_length;
+        if (frame.masked_) {
+            frame.mask_key_.assign(data + pos - 4, 4);
+        } else {
+            frame.mask_key_.clear();
+        }
+
+        // 解析载荷数据
+        frame.payload_.assign(data + pos, payload_length);
+        if (frame.masked_) {
+            for (size_t i = 0; i < frame.payload_.length(); ++i) {
+                frame.payload_[i] = frame.payload_[i] ^ frame.mask_key_[i % 4];
+            }
+        }
+        frame.payload_length_ = frame.payload_.length();
+
+        consumed = frame_size;
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+private:
+    bool fin_;
+    uint8_t rsv_;
+    uint8_t opcode_;
+    bool masked_;
+    std::string mask_key_;
+    std::string payload_;
+    size_t payload_length_;
+};
+
+// 接收缓冲区：握手响应之后的数据和未处理完的帧都留在这里，按读写偏移消费，不逐帧拷贝
+class ReceiveBuffer {
+public:
+    ReceiveBuffer() : read_(0), write_(0) {}
+
+    const char* data() const { return buffer_.data() + read_; }
+    size_t size() const { return write_ - read_; }
+    bool empty() const { return read_ == write_; }
+
+    void consume(size_t n) {
+        read_ += n;
+        if (read_ >= write_) {
+            read_ = write_ = 0;
+        }
+    }
+
+    // 保证尾部至少有min字节(不少于16KB)可写空间，先整理已消费的空间再扩容
+    char* prepare(size_t min) {
+        const size_t min_read_size = 16 * 1024;
+        if (min < min_read_size) {
+            min = min_read_size;
+        }
+        if (buffer_.size() - write_ < min) {
+            if (read_ > 0) {
+                memmove(&buffer_[0], &buffer_[read_], write_ - read_);
+                write_ -= read_;
+                read_ = 0;
+            }
+            if (buffer_.size() - write_ < min) {
+                buffer_.resize(write_ + min);
             }
-            request += "Sec-WebSocket-Extensions: " + extensions + "\r\n";
         }
+        return &buffer_[write_];
+    }
+
+    size_t writable() const { return buffer_.size() - write_; }
+    void commit(size_t n) { write_ += n; }
+
+    // 清空并释放大帧留下的内存
+    void clear() {
+        read_ = write_ = 0;
+        std::vector<char>().swap(buffer_);
+    }
 
-        request += "\r\n";
+private:
+    std::vector<char> buffer_;
+    size_t read_;
+    size_t write_;
+};
+
+// WebSocket握手类
+class WebSocketHandshake {
+public:
+    static WebSocketResult createHandshakeRequest(const URL& url, const WebSocketConfig& config, std::string& request, std::string& accept_key) noexcept {
+        unsigned char nonce[16];
+        if (!FastRandom::local().fill(nonce, sizeof(nonce))) {
+            return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Failed to generate handshake key");
+        }
+        std::string key = Utils::base64Encode(std::string(reinterpret_cast<const char*>(nonce), sizeof(nonce)));
+
+        // Sec-WebSocket-Accept = base64(SHA1(key + GUID))
+        static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        char digest_input[24 + sizeof(guid) - 1];
+        memcpy(digest_input, key.data(), key.size());
+        memcpy(digest_input + key.size(), guid, sizeof(guid) - 1);
+        unsigned char digest[SHA_DIGEST_LENGTH];
+        SHA1(reinterpret_cast<const unsigned char*>(digest_input), key.size() + sizeof(guid) - 1, digest);
+        accept_key = Utils::base64Encode(std::string(reinterpret_cast<const char*>(digest), sizeof(digest)));
+
+        std::shared_ptr<const RequestTemplate> tmpl = requestTemplate(url, config);
+        request.clear();
+        request.reserve(tmpl->prefix.size() + key.size() + tmpl->suffix.size());
+        request.append(tmpl->prefix);
+        request.append(key);
+        request.append(tmpl->suffix);
         return WebSocketResult(ResultCode::SUCCESS, "");
     }
 
-    static WebSocketResult parseHandshakeResponse(const std::string& response, const std::string& accept_key) noexcept {
-        std::vector<std::string> lines = Utils::split(response, '\n');
-        if (lines.empty()) {
+    static WebSocketResult parseHandshakeResponse(const std::string& response, const std::string& accept_key,
+                                                  std::string* extensions = nullptr) noexcept {
+        return parseHandshakeResponse(response.data(), response.size(), accept_key, extensions);
+    }
+
+    // 查找响应头结尾，返回包含空行在内的头部长度，未找到返回0
+    // from为上次已扫描的长度，避免重复扫描
+    static size_t findHeaderEnd(const char* data, size_t len, size_t from) noexcept {
+        size_t i = from > 3 ? from - 3 : 0;
+        for (; i + 4 <= len; ++i) {
+            const char* p = static_cast<const char*>(memchr(data + i, '\r', len - i));
+            if (p == nullptr) break;
+            i = p - data;
+            if (i + 4 <= len && p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+                return i + 4;
+            }
+        }
+        return 0;
+    }
+
+    // 单遍扫描响应头，不做拷贝，data应包含到空行为止的完整响应头
+    // extensions非空时返回服务端接受的Sec-WebSocket-Extensions
+    static WebSocketResult parseHandshakeResponse(const char* data, size_t len, const std::string& accept_key,
+                                                  std::string* extensions = nullptr) noexcept {
+        const char* p = data;
+        const char* end = data + len;
+
+        const char* line_end = findLineEnd(p, end);
+        if (line_end == p) {
             return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Empty response");
         }
 
         // 检查状态行
-        std::string status_line = Utils::trim(lines[0]);
-        if (status_line.find("HTTP/1.1 101") == std::string::npos) {
-            return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Invalid status line : " + status_line);
+        static const char status[] = "HTTP/1.1 101";
+        size_t status_len = sizeof(status) - 1;
+        const char* status_end = trimRight(p, line_end);
+        if (static_cast<size_t>(status_end - p) < status_len || memcmp(p, status, status_len) != 0 ||
+            (static_cast<size_t>(status_end - p) > status_len && p[status_len] != ' ')) {
+            return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Invalid status line : " + std::string(p, status_end));
         }
 
         // 检查必需的头部
         bool has_upgrade = false, has_connection = false, has_accept = false;
-        for (size_t i = 1; i < lines.size(); ++i) {
-            std::string line = Utils::trim(lines[i]);
-            if (line.empty()) break;
-
-            size_t colon_pos = line.find(':');
-            if (colon_pos == std::string::npos) continue;
-
-            std::string key = Utils::toLower(Utils::trim(line.substr(0, colon_pos)));
-            std::string value = Utils::trim(line.substr(colon_pos + 1));
-
-            if (key == "upgrade" && Utils::toLower(value) == "websocket") {
-                has_upgrade = true;
-            } else if (key == "connection" && Utils::toLower(value).find("upgrade") != std::string::npos) {
-                has_connection = true;
-            } else if (key == "sec-websocket-accept") {
-                if (value != accept_key) {
-                    return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Invalid accept key : " + value);
+        for (p = nextLine(line_end, end); p < end; p = nextLine(line_end, end)) {
+            line_end = findLineEnd(p, end);
+            const char* line_stop = trimRight(p, line_end);
+            if (line_stop == p) break;
+
+            const char* colon = static_cast<const char*>(memchr(p, ':', line_stop - p));
+            if (colon == nullptr) continue;
+
+            const char* name_end = trimRight(p, colon);
+            const char* value = trimLeft(colon + 1, line_stop);
+            size_t name_len = name_end - p;
+            size_t value_len = line_stop - value;
+
+            if (equalsIgnoreCase(p, name_len, "upgrade")) {
+                has_upgrade = equalsIgnoreCase(value, value_len, "websocket");
+            } else if (equalsIgnoreCase(p, name_len, "connection")) {
+                has_connection = containsIgnoreCase(value, value_len, "upgrade");
+            } else if (equalsIgnoreCase(p, name_len, "sec-websocket-accept")) {
+                if (value_len != accept_key.size() || memcmp(value, accept_key.data(), value_len) != 0) {
+                    return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Invalid accept key : " + std::string(value, value_len));
                 }
-
                 has_accept = true;
+            } else if (extensions && equalsIgnoreCase(p, name_len, "sec-websocket-extensions")) {
+                if (!extensions->empty()) *extensions += ", ";
+                extensions->append(value, value_len);
             }
         }
 
@@ -987,11 +2256,430 @@ public:
 
         return WebSocketResult(ResultCode::SUCCESS, "");
     }
-};
-
 
-class TaskRunner {
-public:
+private:
+    // 请求中除Sec-WebSocket-Key取值外的部分，同一URL和配置的连接共用
+    struct RequestTemplate {
+        std::string scheme;
+        std::string host;
+        int port;
+        std::string path;
+        std::string query;
+        std::map<std::string, std::string> headers;
+        std::map<std::string, std::string> extensions;
+        std::string deflate_offer;
+        std::string prefix;
+        std::string suffix;
+    };
+
+    static std::shared_ptr<const RequestTemplate> requestTemplate(const URL& url, const WebSocketConfig& config) {
+        static std::mutex mtx;
+        static std::unordered_map<size_t, std::shared_ptr<const RequestTemplate>> cache;
+        static const size_t max_cache_size = 1024;
+
+        size_t hash = templateHash(url, config);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = cache.find(hash);
+            if (it != cache.end() && matches(*it->second, url, config)) {
+                return it->second;
+            }
+        }
+
+        std::shared_ptr<const RequestTemplate> tmpl = buildTemplate(url, config);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (cache.size() >= max_cache_size) {
+            cache.clear();
+        }
+        cache[hash] = tmpl;
+        return tmpl;
+    }
+
+    static std::shared_ptr<const RequestTemplate> buildTemplate(const URL& url, const WebSocketConfig& config) {
+        std::shared_ptr<RequestTemplate> tmpl = std::make_shared<RequestTemplate>();
+        tmpl->scheme = url.scheme();
+        tmpl->host = url.host();
+        tmpl->port = url.port();
+        tmpl->path = url.path();
+        tmpl->query = url.query();
+        tmpl->headers = config.getHeaders();
+        tmpl->extensions = config.getExtensions();
+        tmpl->deflate_offer = deflateOffer(config);
+
+        std::string& prefix = tmpl->prefix;
+        prefix = "GET " + url.path();
+        if (!url.query().empty()) {
+            prefix += "?" + url.query();
+        }
+        prefix += " HTTP/1.1\r\n";
+        prefix += "Host: " + url.hostHeader();
+        if (url.port() != (url.scheme() == "wss" ? 443 : 80)) {
+            prefix += ":" + std::to_string(url.port());
+        }
+        prefix += "\r\n";
+        prefix += "Upgrade: websocket\r\n";
+        prefix += "Connection: Upgrade\r\n";
+        prefix += "Sec-WebSocket-Key: ";
+
+        std::string& suffix = tmpl->suffix;
+        suffix = "\r\nSec-WebSocket-Version: 13\r\n";
+
+        // 添加自定义头部
+        for (const auto& header : config.getHeaders()) {
+            suffix += header.first + ": " + header.second + "\r\n";
+        }
+
+        // 添加扩展，permessage-deflate总是按压缩配置生成，未启用压缩时不提出
+        std::map<std::string, std::string> offered = config.getExtensions();
+        offered.erase("permessage-deflate");
+        if (!tmpl->deflate_offer.empty()) {
+            offered["permessage-deflate"] = tmpl->deflate_offer;
+        }
+        if (!offered.empty()) {
+            std::string extensions;
+            for (const auto& ext : offered) {
+                if (!extensions.empty()) extensions += ", ";
+                extensions += ext.first;
+                if (!ext.second.empty()) {
+                    extensions += "; " + ext.second;
+                }
+            }
+            suffix += "Sec-WebSocket-Extensions: " + extensions + "\r\n";
+        }
+
+        suffix += "\r\n";
+        return tmpl;
+    }
+
+    static size_t templateHash(const URL& url, const WebSocketConfig& config) {
+        std::hash<std::string> hasher;
+        size_t hash = hasher(url.scheme());
+        auto combine = [&hash](size_t value) {
+            hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        };
+        combine(hasher(url.host()));
+        combine(std::hash<int>()(url.port()));
+        combine(hasher(url.path()));
+        combine(hasher(url.query()));
+        for (const auto& header : config.getHeaders()) {
+            combine(hasher(header.first));
+            combine(hasher(header.second));
+        }
+        for (const auto& ext : config.getExtensions()) {
+            combine(hasher(ext.first));
+            combine(hasher(ext.second));
+        }
+        combine(hasher(deflateOffer(config)));
+        return hash;
+    }
+
+    static bool matches(const RequestTemplate& tmpl, const URL& url, const WebSocketConfig& config) {
+        return tmpl.port == url.port() && tmpl.host == url.host() && tmpl.path == url.path() &&
+               tmpl.query == url.query() && tmpl.scheme == url.scheme() &&
+               tmpl.headers == config.getHeaders() && tmpl.extensions == config.getExtensions() &&
+               tmpl.deflate_offer == deflateOffer(config);
+    }
+
+    // 返回行尾('\n'所在位置或end)
+    static const char* findLineEnd(const char* p, const char* end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        return nl ? nl : end;
+    }
+
+    static const char* nextLine(const char* line_end, const char* end) {
+        return line_end < end ? line_end + 1 : end;
+    }
+
+    static const char* trimLeft(const char* p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        return p;
+    }
+
+    static const char* trimRight(const char* begin, const char* p) {
+        while (p > begin && (p[-1] == ' ' || p[-1] == '\t' || p[-1] == '\r')) --p;
+        return p;
+    }
+
+    static char lower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    // literal须为小写
+    static bool equalsIgnoreCase(const char* p, size_t len, const char* literal) {
+        size_t i = 0;
+        for (; i < len && literal[i] != '\0'; ++i) {
+            if (lower(p[i]) != literal[i]) return false;
+        }
+        return i == len && literal[i] == '\0';
+    }
+
+    static bool containsIgnoreCase(const char* p, size_t len, const char* literal) {
+        size_t literal_len = strlen(literal);
+        for (size_t i = 0; i + literal_len <= len; ++i) {
+            if (equalsIgnoreCase(p + i, literal_len, literal)) return true;
+        }
+        return false;
+    }
+
+public:
+    // 在Sec-WebSocket-Extensions中查找扩展参数，找到时返回true并取出参数值(去掉引号)
+    static bool findExtensionParam(const std::string& header, const char* extension, const char* param, std::string& value) {
+        const char* p = header.data();
+        const char* end = p + header.size();
+        while (p < end) {
+            const char* ext_end = static_cast<const char*>(memchr(p, ',', end - p));
+            if (ext_end == nullptr) ext_end = end;
+
+            // 扩展名与各参数以';'分隔
+            bool matched = false;
+            bool first = true;
+            while (p < ext_end) {
+                const char* item_end = static_cast<const char*>(memchr(p, ';', ext_end - p));
+                if (item_end == nullptr) item_end = ext_end;
+                const char* item = trimLeft(p, item_end);
+                const char* item_stop = trimRight(item, item_end);
+
+                if (first) {
+                    matched = equalsIgnoreCase(item, item_stop - item, extension);
+                    first = false;
+                } else if (matched) {
+                    const char* eq = static_cast<const char*>(memchr(item, '=', item_stop - item));
+                    const char* name_stop = trimRight(item, eq ? eq : item_stop);
+                    if (equalsIgnoreCase(item, name_stop - item, param)) {
+                        const char* v = eq ? trimLeft(eq + 1, item_stop) : item_stop;
+                        if (item_stop - v >= 2 && *v == '"' && item_stop[-1] == '"') {
+                            ++v;
+                            --item_stop;
+                        }
+                        value.assign(v, item_stop);
+                        return true;
+                    }
+                }
+                p = item_end < ext_end ? item_end + 1 : ext_end;
+            }
+            p = ext_end < end ? ext_end + 1 : end;
+        }
+        return false;
+    }
+
+private:
+    // 是否在握手中提出permessage-deflate，未编译zlib时始终为false
+    static bool compressionOffered(const WebSocketConfig& config) {
+        #ifdef USE_ZLIB
+        return config.isCompressionEnabled();
+        #else
+        (void)config;
+        return false;
+        #endif
+    }
+
+    // 需要在握手中提出的字典id，未启用压缩或未设置字典时为空
+    static std::string offeredDictionaryId(const WebSocketConfig& config) {
+        return compressionOffered(config) ? config.getCompressionDictionaryId() : std::string();
+    }
+
+    // permessage-deflate的参数部分，不提出压缩时为空
+    static std::string deflateOffer(const WebSocketConfig& config) {
+        if (!compressionOffered(config)) {
+            return std::string();
+        }
+
+        DeflateParams offer = offeredDeflateParams(config);
+        std::string params;
+        if (offer.client_no_context_takeover) {
+            params += "client_no_context_takeover; server_no_context_takeover; ";
+        }
+        // 窗口为15时只声明支持client_max_window_bits，由服务端决定客户端的窗口
+        if (offer.client_max_window_bits < 15) {
+            params += "client_max_window_bits=" + std::to_string(offer.client_max_window_bits) +
+                      "; server_max_window_bits=" + std::to_string(offer.server_max_window_bits);
+        } else {
+            params += "client_max_window_bits";
+        }
+        std::string dictionary_id = offeredDictionaryId(config);
+        if (!dictionary_id.empty()) {
+            params += "; dictionary_id=" + dictionary_id;
+        }
+        return params;
+    }
+
+    // 扩展头中的一项: 扩展名和按顺序排列的参数，无值参数的值为空
+    struct ExtensionElement {
+        std::string name;
+        std::vector<std::pair<std::string, std::string>> params;
+    };
+
+    static std::vector<ExtensionElement> parseExtensions(const std::string& header) {
+        std::vector<ExtensionElement> elements;
+        const char* p = header.data();
+        const char* end = p + header.size();
+        while (p < end) {
+            const char* ext_end = static_cast<const char*>(memchr(p, ',', end - p));
+            if (ext_end == nullptr) ext_end = end;
+
+            ExtensionElement element;
+            bool first = true;
+            while (p < ext_end) {
+                const char* item_end = static_cast<const char*>(memchr(p, ';', ext_end - p));
+                if (item_end == nullptr) item_end = ext_end;
+                const char* item = trimLeft(p, item_end);
+                const char* item_stop = trimRight(item, item_end);
+
+                const char* eq = static_cast<const char*>(memchr(item, '=', item_stop - item));
+                const char* name_stop = trimRight(item, eq ? eq : item_stop);
+                std::string name;
+                for (const char* c = item; c < name_stop; ++c) name.push_back(lower(*c));
+                if (first) {
+                    element.name = name;
+                    first = false;
+                } else if (!name.empty()) {
+                    const char* v = eq ? trimLeft(eq + 1, item_stop) : item_stop;
+                    if (item_stop - v >= 2 && *v == '"' && item_stop[-1] == '"') {
+                        ++v;
+                        --item_stop;
+                    }
+                    element.params.push_back(std::make_pair(name, std::string(v, item_stop)));
+                }
+                p = item_end < ext_end ? item_end + 1 : ext_end;
+            }
+            if (!element.name.empty()) {
+                elements.push_back(element);
+            }
+            p = ext_end < end ? ext_end + 1 : end;
+        }
+        return elements;
+    }
+
+    // 窗口参数取值8-15
+    static bool parseWindowBits(const std::string& value, int& bits) {
+        if (value.size() < 1 || value.size() > 2 || value.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        bits = std::atoi(value.c_str());
+        return bits >= 8 && bits <= 15;
+    }
+
+public:
+    // 按压缩配置提出的permessage-deflate参数
+    static DeflateParams offeredDeflateParams(const WebSocketConfig& config) {
+        DeflateParams offer;
+        offer.client_no_context_takeover = offer.server_no_context_takeover = !config.isCompressionContextTakeover();
+        offer.client_max_window_bits = offer.server_max_window_bits = config.getCompressionWindowBits();
+        return offer;
+    }
+
+    // 校验服务端响应的Sec-WebSocket-Extensions并得出两个方向的压缩参数(RFC 7692 7.1)，
+    // 服务端未接受压缩时active为false；响应与提议不符时返回HANDSHAKE_ERROR
+    static WebSocketResult negotiateDeflate(const std::string& extensions, const WebSocketConfig& config,
+                                            DeflateParams& params, bool& active, bool& dictionary) {
+        active = false;
+        dictionary = false;
+        params = DeflateParams();
+
+        const ExtensionElement* accepted = nullptr;
+        std::vector<ExtensionElement> elements = parseExtensions(extensions);
+        for (const auto& element : elements) {
+            if (element.name != "permessage-deflate") {
+                continue;
+            }
+            if (accepted) {
+                return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Duplicate permessage-deflate in response");
+            }
+            accepted = &element;
+        }
+        if (!accepted) {
+            return WebSocketResult(ResultCode::SUCCESS, "");
+        }
+        if (!compressionOffered(config)) {
+            return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Server accepted permessage-deflate that was not offered");
+        }
+
+        DeflateParams offer = offeredDeflateParams(config);
+        bool has_server_window = false;
+        std::set<std::string> seen;
+        for (const auto& param : accepted->params) {
+            const std::string& name = param.first;
+            if (!seen.insert(name).second) {
+                return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Duplicate permessage-deflate parameter: " + name);
+            }
+
+            if (name == "server_no_context_takeover" || name == "client_no_context_takeover") {
+                if (!param.second.empty()) {
+                    return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Unexpected value for " + name);
+                }
+                (name[0] == 's' ? params.server_no_context_takeover : params.client_no_context_takeover) = true;
+            } else if (name == "server_max_window_bits") {
+                if (!parseWindowBits(param.second, params.server_max_window_bits) ||
+                    params.server_max_window_bits > offer.server_max_window_bits) {
+                    return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Invalid server_max_window_bits: " + param.second);
+                }
+                has_server_window = true;
+            } else if (name == "client_max_window_bits") {
+                // zlib的raw deflate不支持8位窗口
+                if (!parseWindowBits(param.second, params.client_max_window_bits) ||
+                    params.client_max_window_bits > offer.client_max_window_bits || params.client_max_window_bits < 9) {
+                    return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Invalid client_max_window_bits: " + param.second);
+                }
+            } else if (name == "dictionary_id") {
+                if (param.second.empty() || param.second != offeredDictionaryId(config)) {
+                    return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Unexpected dictionary_id: " + param.second);
+                }
+                dictionary = true;
+            } else {
+                return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Unknown permessage-deflate parameter: " + name);
+            }
+        }
+
+        // 提出的server_*限制服务端必须接受
+        if (offer.server_no_context_takeover && !params.server_no_context_takeover) {
+            return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Server did not accept server_no_context_takeover");
+        }
+        if (offer.server_max_window_bits < 15 && !has_server_window) {
+            return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Server did not accept server_max_window_bits");
+        }
+        // 客户端自己提出的限制即使服务端未回应也照样遵守
+        params.client_no_context_takeover = params.client_no_context_takeover || offer.client_no_context_takeover;
+        if (!seen.count("client_max_window_bits")) {
+            params.client_max_window_bits = offer.client_max_window_bits;
+        }
+
+        active = true;
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+};
+
+// 可在接收/投递线程调用期间替换的回调：调用时在锁内取一份引用，锁外执行；
+// 替换后已经开始的调用仍用旧回调执行完
+template <typename Function> class CallbackSlot {
+public:
+    void set(Function callback) {
+        std::shared_ptr<const Function> next;
+        if (callback) {
+            next = std::make_shared<const Function>(std::move(callback));
+        }
+        std::lock_guard<std::mutex> lock(mtx_);
+        callback_.swap(next);
+    }
+
+    template <typename... Args> void operator()(Args&&... args) const {
+        std::shared_ptr<const Function> callback;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            callback = callback_;
+        }
+        if (callback) {
+            (*callback)(std::forward<Args>(args)...);
+        }
+    }
+
+private:
+    mutable std::mutex mtx_;
+    std::shared_ptr<const Function> callback_;
+};
+
+
+class TaskRunner {
+public:
     TaskRunner() : run_(false) {}
     ~TaskRunner() {
         stop();
@@ -1003,394 +2691,3839 @@ public:
             return;
         }
 
-        run_ = true;
-        worker_ = std::thread([this] { run(); });
+        run_ = true;
+        worker_ = std::thread([this] { run(); });
+    }
+
+    void stop() noexcept {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (!run_) {
+                return;
+            }
+
+            run_ = false;
+        }
+
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    void push_task(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            tasks_.push(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    void clear() {
+        std::queue<std::function<void()>> discarded;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            tasks_.swap(discarded);
+        }
+        cv_.notify_all();
+    }
+
+private:
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this] { return !run_ || !tasks_.empty(); });
+
+                if (!run_ && tasks_.empty()) {
+                    return;
+                }
+
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::thread worker_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::queue<std::function<void()>> tasks_;
+    bool run_;
+};
+
+// 共享线程池，用于把大消息的压缩/解压移出调用者线程和I/O线程，线程在首次提交任务时创建
+class WorkerPool {
+public:
+    static WorkerPool& shared() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    ~WorkerPool() {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            run_ = false;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    // 设置线程数，只在首次提交任务前生效，0表示按CPU核数的一半
+    void setThreadCount(size_t count) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        thread_count_ = count;
+    }
+
+    void post(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (workers_.empty()) {
+                size_t count = thread_count_;
+                if (count == 0) {
+                    count = std::max(1u, std::thread::hardware_concurrency() / 2);
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    workers_.emplace_back([this] { run(); });
+                }
+            }
+            tasks_.push(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    WorkerPool() : thread_count_(0), run_(true) {}
+
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this] { return !run_ || !tasks_.empty(); });
+                if (!run_ && tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::queue<std::function<void()>> tasks_;
+    size_t thread_count_;
+    bool run_;
+};
+
+// 串行执行器：同一连接的任务按提交顺序在线程池上逐个执行，不同连接之间并行
+class SerialExecutor {
+public:
+    explicit SerialExecutor(WorkerPool& pool = WorkerPool::shared()) : pool_(pool), pending_(0), running_(false) {}
+
+    ~SerialExecutor() {
+        waitIdle();
+    }
+
+    void post(std::function<void()> task) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        tasks_.push(std::move(task));
+        ++pending_;
+        if (!running_) {
+            running_ = true;
+            pool_.post([this] { drain(); });
+        }
+    }
+
+    // 已提交但未执行完的任务数，为0时调用者可以直接在本线程处理而不破坏顺序
+    size_t pending() const { return pending_.load(); }
+
+    // 等待所有任务执行完
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        idle_.wait(lock, [this] { return !running_; });
+    }
+
+private:
+    void drain() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                if (tasks_.empty()) {
+                    running_ = false;
+                    idle_.notify_all();
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+            --pending_;
+        }
+    }
+
+    WorkerPool& pool_;
+    std::mutex mtx_;
+    std::condition_variable idle_;
+    std::queue<std::function<void()>> tasks_;
+    std::atomic<size_t> pending_;
+    bool running_;
+};
+
+
+// 接收流控统计
+struct ReceiveFlowStats {
+    size_t pending_messages = 0;      // 当前未投递的消息数
+    size_t max_pending_messages = 0;  // 未投递消息数峰值
+    uint64_t pause_count = 0;         // 暂停读取次数
+    uint64_t total_pause_ns = 0;      // 累计暂停时间(纳秒)
+    uint64_t max_pause_ns = 0;        // 单次最长暂停时间(纳秒)
+    bool paused = false;              // 当前是否处于暂停状态
+};
+
+// 接收流控：未投递消息达到高水位时暂停读socket，由TCP向服务端施加背压，降到低水位后恢复
+class ReceiveFlowControl {
+public:
+    ReceiveFlowControl() : high_watermark_(0), low_watermark_(0), stopped_(false) {}
+
+    void setWatermarks(size_t high, size_t low) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        high_watermark_ = high;
+        low_watermark_ = (low < high) ? low : high;
+    }
+
+    // 新连接开始前重置状态，统计保留
+    void reset() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        stats_.pending_messages = 0;
+        stats_.paused = false;
+        stopped_ = false;
+    }
+
+    // 唤醒所有等待者，之后waitForCapacity立即返回false
+    void stop() {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            stopped_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    // I/O线程解出一条完整消息
+    void onEnqueue() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        ++stats_.pending_messages;
+        if (stats_.pending_messages > stats_.max_pending_messages) {
+            stats_.max_pending_messages = stats_.pending_messages;
+        }
+    }
+
+    // 消费者取走count条消息
+    void onDelivered(size_t count = 1) {
+        bool resume = false;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            stats_.pending_messages -= (count < stats_.pending_messages) ? count : stats_.pending_messages;
+            if (stats_.paused && stats_.pending_messages <= low_watermark_) {
+                stats_.paused = false;
+                resume = true;
+            }
+        }
+        if (resume) {
+            cv_.notify_all();
+        }
+    }
+
+    // 阻塞直到允许继续读取，返回false表示已停止
+    bool waitForCapacity() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (stopped_) {
+            return false;
+        }
+        if (high_watermark_ == 0 || stats_.pending_messages < high_watermark_) {
+            return true;
+        }
+
+        stats_.paused = true;
+        ++stats_.pause_count;
+        auto start = std::chrono::steady_clock::now();
+        cv_.wait(lock, [this] { return stopped_ || !stats_.paused; });
+
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        stats_.total_pause_ns += elapsed;
+        if (elapsed > stats_.max_pause_ns) {
+            stats_.max_pause_ns = elapsed;
+        }
+        stats_.paused = false;
+        return !stopped_;
+    }
+
+    ReceiveFlowStats stats() const {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return stats_;
+    }
+
+private:
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    size_t high_watermark_;
+    size_t low_watermark_;
+    bool stopped_;
+    ReceiveFlowStats stats_;
+};
+
+
+// 发送完成回调，消息写入socket、发送失败或被丢弃时调用
+typedef std::function<void(const WebSocketResult&)> SendCompletion;
+
+// 待发送的消息，数据消息由发送线程按分片大小拆帧
+struct OutboundMessage {
+    FrameType type = FrameType::TEXT;
+    SendPriority priority = SendPriority::NORMAL;
+    std::string payload;   // 未分帧的载荷，compress为true时由发送线程出队后压缩
+    bool compress = false;    // 需要压缩
+    bool compressed = false;  // 已压缩，第一帧需要设置RSV1
+    size_t offset = 0;     // 已写入socket的载荷字节数
+    SendCompletion completion;
+};
+
+// 发送队列：按优先级分通道，调用者入队后立即返回，由发送线程写入socket
+class SendQueue {
+public:
+    SendQueue() : max_bytes_(0), policy_(SendQueuePolicy::REJECT), buffered_bytes_(0), closed_(false) {}
+
+    void configure(size_t max_bytes, SendQueuePolicy policy) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        max_bytes_ = max_bytes;
+        policy_ = policy;
+    }
+
+    // 新连接开始前调用，上个连接的消息已全部写出或以错误完成
+    void reset() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        assert(empty());
+        buffered_bytes_ = 0;
+        closed_ = false;
+    }
+
+    // 入队，控制帧不受容量限制
+    WebSocketResult push(OutboundMessage message, int timeout_ms) {
+        std::vector<OutboundMessage> dropped;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (closed_) {
+                return WebSocketResult(ResultCode::CLOSED, "Send queue is closed");
+            }
+
+            size_t size = message.payload.length();
+            if (message.priority != SendPriority::CONTROL && !hasRoom(size)) {
+                switch (policy_) {
+                    case SendQueuePolicy::REJECT:
+                        return WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Send queue is full");
+                    case SendQueuePolicy::BLOCK: {
+                        auto ready = [this, size] { return closed_ || hasRoom(size); };
+                        if (timeout_ms < 0) {
+                            not_full_.wait(lock, ready);
+                        } else if (!not_full_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+                            return WebSocketResult(ResultCode::TIMEOUT, "Send queue is full: timeout");
+                        }
+                        if (closed_) {
+                            return WebSocketResult(ResultCode::CLOSED, "Send queue is closed");
+                        }
+                        break;
+                    }
+                    case SendQueuePolicy::DROP_OLDEST:
+                        // 从最低优先级通道的最早消息开始丢弃，控制帧不丢弃
+                        for (int lane = LANE_COUNT - 1; lane > 0 && !hasRoom(size); --lane) {
+                            while (!hasRoom(size) && !lanes_[lane].empty()) {
+                                buffered_bytes_ -= lanes_[lane].front().payload.length();
+                                dropped.push_back(std::move(lanes_[lane].front()));
+                                lanes_[lane].pop_front();
+                            }
+                        }
+                        break;
+                }
+            }
+
+            buffered_bytes_ += size;
+            lanes_[static_cast<int>(message.priority)].push_back(std::move(message));
+        }
+        not_empty_.notify_one();
+
+        for (auto& m : dropped) {
+            if (m.completion) {
+                m.completion(WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Message dropped: send queue is full"));
+            }
+        }
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+    // 取出优先级最高的消息，队列关闭且为空时返回false
+    bool pop(OutboundMessage& message) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_empty_.wait(lock, [this] { return closed_ || !empty(); });
+        for (int lane = 0; lane < LANE_COUNT; ++lane) {
+            if (!lanes_[lane].empty()) {
+                message = std::move(lanes_[lane].front());
+                lanes_[lane].pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 非阻塞取出控制帧，用于在数据消息的分片之间插入
+    bool popControl(OutboundMessage& message) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        std::deque<OutboundMessage>& lane = lanes_[static_cast<int>(SendPriority::CONTROL)];
+        if (lane.empty()) {
+            return false;
+        }
+
+        message = std::move(lane.front());
+        lane.pop_front();
+        return true;
+    }
+
+    // 等待控制帧到达或ready变为true，取到控制帧时返回true；用于等待线程池压缩期间继续发送控制帧
+    bool waitControl(OutboundMessage& message, const std::atomic<bool>& ready) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        std::deque<OutboundMessage>& lane = lanes_[static_cast<int>(SendPriority::CONTROL)];
+        not_empty_.wait(lock, [&] { return ready || !lane.empty(); });
+        if (lane.empty()) {
+            return false;
+        }
+
+        message = std::move(lane.front());
+        lane.pop_front();
+        return true;
+    }
+
+    // 唤醒waitControl
+    void wake() {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+        }
+        not_empty_.notify_all();
+    }
+
+    // 出队后载荷大小改变(压缩)时修正已缓冲字节数
+    void resize(size_t old_size, size_t new_size) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            buffered_bytes_ = buffered_bytes_ - old_size + new_size;
+        }
+        not_full_.notify_all();
+    }
+
+    // 发送线程写完bytes字节载荷
+    void complete(size_t bytes) {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            buffered_bytes_ -= bytes;
+        }
+        not_full_.notify_all();
+    }
+
+    // 关闭队列，已入队的消息仍可被取出
+    void close() {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    // 取走全部未发送消息，由调用者通知失败
+    std::deque<OutboundMessage> drain() {
+        std::deque<OutboundMessage> remaining;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            for (int lane = 0; lane < LANE_COUNT; ++lane) {
+                for (auto& m : lanes_[lane]) {
+                    buffered_bytes_ -= m.payload.length();
+                    remaining.push_back(std::move(m));
+                }
+                lanes_[lane].clear();
+            }
+        }
+        not_full_.notify_all();
+        return remaining;
+    }
+
+    // 已入队但尚未写入socket的字节数
+    size_t bufferedAmount() const {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return buffered_bytes_;
+    }
+
+private:
+    static const int LANE_COUNT = 4;
+
+    bool empty() const {
+        for (int lane = 0; lane < LANE_COUNT; ++lane) {
+            if (!lanes_[lane].empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 队列为空时总是允许，避免超过上限的单条消息永远无法发送
+    bool hasRoom(size_t size) const {
+        return max_bytes_ == 0 || buffered_bytes_ == 0 || buffered_bytes_ + size <= max_bytes_;
+    }
+
+    mutable std::mutex mtx_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<OutboundMessage> lanes_[LANE_COUNT];
+    size_t max_bytes_;
+    SendQueuePolicy policy_;
+    size_t buffered_bytes_;
+    bool closed_;
+};
+
+
+// 收到的完整消息
+struct Message {
+    FrameType type = FrameType::TEXT;
+    std::string data;
+};
+
+// 接收等待者，消息到达时由I/O线程调用
+class ReceiveWaiter {
+public:
+    virtual ~ReceiveWaiter() {}
+
+    // 返回false表示等待者已失效(超时/取消)，消息留在队列中
+    virtual bool deliver(Message& message) = 0;
+
+    // 队列关闭
+    virtual void closed() = 0;
+};
+
+// 接收队列，DeliveryMode::QUEUE时I/O线程将消息放入此队列，单一消费者拉取
+class InboundQueue {
+public:
+    enum WaitStatus {
+        READY,    // 已取出消息
+        WAITING,  // 已注册等待者
+        BUSY,     // 已有其他等待者
+        CLOSED    // 队列已关闭
+    };
+
+    InboundQueue() : closed_(false) {}
+
+    // 新连接开始前清空
+    void reset() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        queue_.clear();
+        closed_ = false;
+    }
+
+    // 放入消息，有等待者时直接交给等待者；返回true表示消息已被消费
+    bool push(Message message) {
+        std::shared_ptr<ReceiveWaiter> waiter;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            waiter.swap(waiter_);
+            if (!waiter) {
+                queue_.push_back(std::move(message));
+            }
+        }
+
+        if (waiter) {
+            if (waiter->deliver(message)) {
+                return true;
+            }
+
+            std::unique_lock<std::mutex> lock(mtx_);
+            queue_.push_back(std::move(message));
+        }
+        cv_.notify_one();
+        return false;
+    }
+
+    // 非阻塞取出一条消息
+    bool tryPop(Message& message) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (queue_.empty()) {
+            return false;
+        }
+
+        message = std::move(queue_.front());
+        queue_.pop_front();
+        return true;
+    }
+
+    // 一次取出最多max_count条消息，队列为空时最多等待timeout_ms毫秒(0表示不等待，小于0表示一直等待)
+    size_t popBatch(Message* out, size_t max_count, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (queue_.empty() && timeout_ms != 0) {
+            auto ready = [this] { return closed_ || !queue_.empty(); };
+            if (timeout_ms < 0) {
+                cv_.wait(lock, ready);
+            } else {
+                cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+            }
+        }
+
+        size_t count = 0;
+        while (count < max_count && !queue_.empty()) {
+            out[count++] = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        return count;
+    }
+
+    // 有消息时取出，否则注册等待者
+    WaitStatus popOrWait(Message& message, const std::shared_ptr<ReceiveWaiter>& waiter) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!queue_.empty()) {
+            message = std::move(queue_.front());
+            queue_.pop_front();
+            return READY;
+        }
+        if (closed_) {
+            return CLOSED;
+        }
+        if (waiter_) {
+            return BUSY;
+        }
+
+        waiter_ = waiter;
+        return WAITING;
+    }
+
+    // 撤销等待者(超时/取消)
+    void cancelWait(const ReceiveWaiter* waiter) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (waiter_.get() == waiter) {
+            waiter_.reset();
+        }
+    }
+
+    // 关闭队列，唤醒等待者；已入队的消息仍可取出
+    void close() {
+        std::shared_ptr<ReceiveWaiter> waiter;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            closed_ = true;
+            waiter.swap(waiter_);
+        }
+        cv_.notify_all();
+
+        if (waiter) {
+            waiter->closed();
+        }
+    }
+
+    size_t size() const {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return queue_.size();
+    }
+
+private:
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Message> queue_;
+    std::shared_ptr<ReceiveWaiter> waiter_;
+    bool closed_;
+};
+
+
+// 定时器服务，在独立线程上按到期时间执行回调，回调中不应做耗时操作
+class TimerService {
+public:
+    static TimerService& instance() {
+        static TimerService service;
+        return service;
+    }
+
+    // 返回定时器id，可用于cancel
+    uint64_t schedule(int delay_ms, std::function<void()> callback) {
+        uint64_t id;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            id = next_id_++;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms);
+            timers_[std::make_pair(deadline, id)] = std::move(callback);
+            deadlines_[id] = deadline;
+        }
+        cv_.notify_one();
+        return id;
+    }
+
+    // 取消尚未执行的定时器
+    void cancel(uint64_t id) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        auto it = deadlines_.find(id);
+        if (it == deadlines_.end()) {
+            return;
+        }
+
+        timers_.erase(std::make_pair(it->second, id));
+        deadlines_.erase(it);
+    }
+
+private:
+    TimerService() : next_id_(1), stop_(false) {
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~TimerService() {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!stop_) {
+            if (timers_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+
+            auto it = timers_.begin();
+            if (it->first.first > std::chrono::steady_clock::now()) {
+                cv_.wait_until(lock, it->first.first);
+                continue;
+            }
+
+            std::function<void()> callback = std::move(it->second);
+            deadlines_.erase(it->first.second);
+            timers_.erase(it);
+
+            lock.unlock();
+            callback();
+            lock.lock();
+        }
+    }
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    std::thread worker_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::map<std::pair<TimePoint, uint64_t>, std::function<void()>> timers_;
+    std::map<uint64_t, TimePoint> deadlines_;
+    uint64_t next_id_;
+    bool stop_;
+};
+
+
+// 取消令牌，由CancellationSource触发
+class CancellationToken {
+public:
+    CancellationToken() {}
+
+    explicit operator bool() const noexcept { return static_cast<bool>(state_); }
+
+    bool isCancelled() const {
+        if (!state_) {
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(state_->mtx);
+        return state_->cancelled;
+    }
+
+    // 注册取消回调，回调在调用cancel()的线程执行；已取消时不注册并返回0
+    uint64_t subscribe(std::function<void()> callback) const {
+        if (!state_) {
+            return 0;
+        }
+
+        std::unique_lock<std::mutex> lock(state_->mtx);
+        if (state_->cancelled) {
+            return 0;
+        }
+
+        uint64_t id = state_->next_id++;
+        state_->callbacks[id] = std::move(callback);
+        return id;
+    }
+
+    void unsubscribe(uint64_t id) const {
+        if (!state_) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(state_->mtx);
+        state_->callbacks.erase(id);
+    }
+
+private:
+    friend class CancellationSource;
+
+    struct State {
+        std::mutex mtx;
+        bool cancelled = false;
+        uint64_t next_id = 1;
+        std::map<uint64_t, std::function<void()>> callbacks;
+    };
+
+    explicit CancellationToken(const std::shared_ptr<State>& state) : state_(state) {}
+
+    std::shared_ptr<State> state_;
+};
+
+class CancellationSource {
+public:
+    CancellationSource() : state_(std::make_shared<CancellationToken::State>()) {}
+
+    CancellationToken token() const { return CancellationToken(state_); }
+
+    void cancel() {
+        std::map<uint64_t, std::function<void()>> callbacks;
+        {
+            std::unique_lock<std::mutex> lock(state_->mtx);
+            if (state_->cancelled) {
+                return;
+            }
+
+            state_->cancelled = true;
+            callbacks.swap(state_->callbacks);
+        }
+
+        for (auto& callback : callbacks) {
+            callback.second();
+        }
+    }
+
+private:
+    std::shared_ptr<CancellationToken::State> state_;
+};
+
+
+#ifdef WEBSOCKET_HAS_COROUTINES
+// 协程操作的共享状态：完成、超时、取消三者先到者生效并恢复协程
+class AwaitState : public ReceiveWaiter {
+public:
+    AwaitState() : done_(false), result_(ResultCode::SUCCESS, ""), timer_id_(0), cancel_id_(0), disarmed_(false) {}
+
+    void setHandle(std::coroutine_handle<> handle) { handle_ = handle; }
+
+    // 在完成的线程上恢复协程，返回false表示已被其他路径完成
+    bool complete(const WebSocketResult& result) {
+        if (done_.exchange(true)) {
+            return false;
+        }
+
+        result_ = result;
+        disarm();
+        handle_.resume();
+        return true;
+    }
+
+    // await_suspend中同步完成时调用，不恢复协程
+    bool completeInline(const WebSocketResult& result) {
+        if (done_.exchange(true)) {
+            return false;
+        }
+
+        result_ = result;
+        disarm();
+        return true;
+    }
+
+    bool deliver(Message& message) override {
+        if (done_.exchange(true)) {
+            return false;
+        }
+
+        message_ = std::move(message);
+        disarm();
+        handle_.resume();
+        return true;
+    }
+
+    void closed() override {
+        complete(WebSocketResult(ResultCode::CLOSED, "WebSocket is closed"));
+    }
+
+    // 启动超时和取消，timeout_ms小于0表示不超时
+    void arm(const std::shared_ptr<AwaitState>& self, int timeout_ms, const CancellationToken& token,
+             std::function<void()> on_abort = nullptr) {
+        bool cancelled = false;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (disarmed_) {
+                return;
+            }
+
+            on_abort_ = std::move(on_abort);
+            if (timeout_ms >= 0) {
+                timer_id_ = TimerService::instance().schedule(timeout_ms, [self] {
+                    self->abort(WebSocketResult(ResultCode::TIMEOUT, "Operation timed out"));
+                });
+            }
+            if (token) {
+                token_ = token;
+                cancel_id_ = token.subscribe([self] {
+                    self->abort(WebSocketResult(ResultCode::CANCELLED, "Operation cancelled"));
+                });
+                cancelled = (cancel_id_ == 0);
+            }
+        }
+
+        if (cancelled) {
+            abort(WebSocketResult(ResultCode::CANCELLED, "Operation cancelled"));
+        }
+    }
+
+    const WebSocketResult& result() const { return result_; }
+    Message& message() { return message_; }
+
+private:
+    void abort(const WebSocketResult& result) {
+        std::function<void()> on_abort;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            on_abort = on_abort_;
+        }
+        if (on_abort) {
+            on_abort();
+        }
+        complete(result);
+    }
+
+    void disarm() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        disarmed_ = true;
+        if (timer_id_) {
+            TimerService::instance().cancel(timer_id_);
+        }
+        if (cancel_id_) {
+            token_.unsubscribe(cancel_id_);
+        }
+        on_abort_ = nullptr;
+    }
+
+    std::atomic<bool> done_;
+    std::coroutine_handle<> handle_;
+    WebSocketResult result_;
+    Message message_;
+
+    std::mutex mtx_;
+    uint64_t timer_id_;
+    uint64_t cancel_id_;
+    CancellationToken token_;
+    std::function<void()> on_abort_;
+    bool disarmed_;
+};
+
+// co_await client.receive() 的结果
+struct ReceiveResult {
+    WebSocketResult result;
+    Message message;
+};
+#endif
+
+
+// 录制的帧方向
+enum class TrafficDirection : uint8_t {
+    INBOUND = 0,    // 收到的帧
+    OUTBOUND = 1    // 发出的帧(未加掩码)
+};
+
+// 回放节奏
+enum class ReplayPace {
+    ORIGINAL,   // 按录制时的时间间隔
+    MAX_SPEED   // 不等待，尽快回放
+};
+
+// 录制文件中的一帧，data指向映射的文件内容，回放器关闭前有效
+struct RecordedFrame {
+    int64_t timestamp_ns = 0;   // 录制时的系统时间(纳秒)
+    int64_t steady_ns = 0;      // 录制时的单调时钟(纳秒)，用于按原间隔回放，不受系统时间调整影响
+    TrafficDirection direction = TrafficDirection::INBOUND;
+    uint8_t opcode = 0;
+    bool fin = true;
+    uint8_t rsv = 0;            // RSV1-3，RSV1表示permessage-deflate压缩
+    const char* data = nullptr;
+    size_t length = 0;
+};
+
+// 录制文件格式: 按序号分段的 <prefix>.NNNNNN.wsrec，每段以64字节段头开始，后接按8字节对齐的记录
+// 段头: magic(8) version(4) header_size(4) capacity(8) used(8)，used为已写入的字节数(含段头)
+// 记录: timestamp_ns(8) length(4) direction(1) opcode(1) fin(1) rsv(1) steady_ns(8) payload(length)
+struct TrafficFormat {
+    static const size_t kHeaderSize = 64;
+    static const size_t kRecordHeaderSize = 24;
+    static const size_t kUsedOffset = 24;
+    static const uint32_t kVersion = 2;
+
+    static const char* magic() { return "WSREC\0\0\0"; }
+
+    static std::string segmentPath(const std::string& prefix, size_t index) {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".%06zu.wsrec", index);
+        return prefix + suffix;
+    }
+
+    static size_t align(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+};
+
+// 流量录制器：每帧追加写入内存映射的分段文件，不经过流式I/O，收发线程可同时写入
+class TrafficRecorder {
+public:
+    TrafficRecorder() : segment_bytes_(0), index_(0), fd_(-1), base_(nullptr), capacity_(0), used_(0), open_(false) {}
+
+    ~TrafficRecorder() {
+        close();
+    }
+
+    // 打开录制，已有的分段保留，从下一个未使用的序号开始写
+    WebSocketResult open(const std::string& prefix, size_t segment_bytes = 64 * 1024 * 1024) {
+        #ifdef _WIN32
+        (void)prefix;
+        (void)segment_bytes;
+        return WebSocketResult(ResultCode::INVALID_STATE, "Traffic recording is not supported on Windows");
+        #else
+        std::lock_guard<std::mutex> lock(mtx_);
+        closeSegment();
+        prefix_ = prefix;
+        segment_bytes_ = std::max(segment_bytes, static_cast<size_t>(64 * 1024));
+        index_ = 0;
+        while (access(TrafficFormat::segmentPath(prefix_, index_).c_str(), F_OK) == 0) {
+            ++index_;
+        }
+        WebSocketResult res = openSegment(0);
+        open_ = static_cast<bool>(res);
+        return res;
+        #endif
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        open_ = false;
+        closeSegment();
+    }
+
+    // 收发线程每帧都会检查，不加锁
+    bool isOpen() const { return open_.load(std::memory_order_acquire); }
+
+    // 追加一帧，当前段放不下时切换到新段；rsv为帧头的RSV1-3位(0-7)
+    void record(TrafficDirection direction, uint8_t opcode, bool fin, uint8_t rsv, const char* data, size_t length) {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        int64_t steady = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        size_t size = TrafficFormat::align(TrafficFormat::kRecordHeaderSize + length);
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!base_) return;
+        if (used_ + size > capacity_) {
+            closeSegment();
+            ++index_;
+            if (!openSegment(size)) {
+                open_ = false;
+                return;
+            }
+        }
+
+        char* p = base_ + used_;
+        uint32_t length32 = static_cast<uint32_t>(length);
+        memcpy(p, &now, 8);
+        memcpy(p + 8, &length32, 4);
+        p[12] = static_cast<char>(direction);
+        p[13] = static_cast<char>(opcode);
+        p[14] = fin ? 1 : 0;
+        p[15] = static_cast<char>(rsv & 0x07);
+        memcpy(p + 16, &steady, 8);
+        if (length > 0) {
+            memcpy(p + TrafficFormat::kRecordHeaderSize, data, length);
+        }
+
+        // 先写记录再更新used，读者只读取used之前的内容
+        used_ += size;
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(base_ + TrafficFormat::kUsedOffset, &used_, 8);
+    }
+
+private:
+    #ifndef _WIN32
+    WebSocketResult openSegment(size_t min_record) {
+        std::string path = TrafficFormat::segmentPath(prefix_, index_);
+        size_t capacity = std::max(segment_bytes_, TrafficFormat::kHeaderSize + min_record);
+
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd_ < 0) {
+            return WebSocketResult(ResultCode::INVALID_PARAMETER, "Failed to create " + path + ": " + strerror(errno));
+        }
+        if (ftruncate(fd_, capacity) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Failed to allocate " + path + ": " + strerror(errno));
+        }
+
+        void* base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (base == MAP_FAILED) {
+            ::close(fd_);
+            fd_ = -1;
+            return WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Failed to map " + path + ": " + strerror(errno));
+        }
+
+        base_ = static_cast<char*>(base);
+        capacity_ = capacity;
+        used_ = TrafficFormat::kHeaderSize;
+
+        uint32_t version = TrafficFormat::kVersion;
+        uint32_t header_size = TrafficFormat::kHeaderSize;
+        uint64_t capacity64 = capacity;
+        memcpy(base_, TrafficFormat::magic(), 8);
+        memcpy(base_ + 8, &version, 4);
+        memcpy(base_ + 12, &header_size, 4);
+        memcpy(base_ + 16, &capacity64, 8);
+        memcpy(base_ + TrafficFormat::kUsedOffset, &used_, 8);
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+    // 解除映射并把文件截到实际大小
+    void closeSegment() {
+        if (base_) {
+            munmap(base_, capacity_);
+            if (ftruncate(fd_, used_) != 0) {
+                // 截断失败不影响读取，读者以段头中的used为准
+            }
+            base_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+    #else
+    WebSocketResult openSegment(size_t) {
+        return WebSocketResult(ResultCode::INVALID_STATE, "Traffic recording is not supported on Windows");
+    }
+    void closeSegment() {}
+    #endif
+
+    std::mutex mtx_;
+    std::string prefix_;
+    size_t segment_bytes_;
+    size_t index_;
+    int fd_;
+    char* base_;
+    size_t capacity_;
+    uint64_t used_;
+    std::atomic<bool> open_;
+};
+
+// 流量回放器：只读映射所有分段，按录制顺序逐帧读取
+class TrafficReplayer {
+public:
+    TrafficReplayer() : segment_(0), offset_(0) {}
+
+    ~TrafficReplayer() {
+        close();
+    }
+
+    // 打开 <prefix>.000000.wsrec 起的所有连续分段
+    WebSocketResult open(const std::string& prefix) {
+        close();
+        #ifdef _WIN32
+        (void)prefix;
+        return WebSocketResult(ResultCode::INVALID_STATE, "Traffic replay is not supported on Windows");
+        #else
+        for (size_t index = 0; ; ++index) {
+            std::string path = TrafficFormat::segmentPath(prefix, index);
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) break;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < TrafficFormat::kHeaderSize) {
+                ::close(fd);
+                close();
+                return WebSocketResult(ResultCode::FRAME_ERROR, "Truncated recording segment " + path);
+            }
+            void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED) {
+                close();
+                return WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Failed to map " + path + ": " + strerror(errno));
+            }
+
+            Segment segment;
+            segment.base = static_cast<const char*>(base);
+            segment.size = st.st_size;
+            segments_.push_back(segment);
+
+            uint64_t used = 0;
+            uint32_t version = 0;
+            memcpy(&used, segment.base + TrafficFormat::kUsedOffset, 8);
+            memcpy(&version, segment.base + 8, 4);
+            if (memcmp(segment.base, TrafficFormat::magic(), 8) != 0 || used > segment.size || used < TrafficFormat::kHeaderSize) {
+                close();
+                return WebSocketResult(ResultCode::FRAME_ERROR, "Invalid recording segment " + path);
+            }
+            if (version != TrafficFormat::kVersion) {
+                close();
+                return WebSocketResult(ResultCode::FRAME_ERROR, "Unsupported recording version " + std::to_string(version) + " in " + path);
+            }
+            segments_.back().used = used;
+        }
+
+        if (segments_.empty()) {
+            return WebSocketResult(ResultCode::INVALID_PARAMETER, "No recording found at " + prefix);
+        }
+        rewind();
+        return WebSocketResult(ResultCode::SUCCESS, "");
+        #endif
+    }
+
+    void close() {
+        #ifndef _WIN32
+        for (auto& segment : segments_) {
+            munmap(const_cast<char*>(segment.base), segment.size);
+        }
+        #endif
+        segments_.clear();
+        segment_ = 0;
+        offset_ = 0;
+    }
+
+    size_t segmentCount() const { return segments_.size(); }
+
+    void rewind() {
+        segment_ = 0;
+        offset_ = TrafficFormat::kHeaderSize;
+    }
+
+    // 读取下一帧，没有更多帧时返回false
+    bool next(RecordedFrame& frame) {
+        while (segment_ < segments_.size()) {
+            const Segment& segment = segments_[segment_];
+            if (offset_ + TrafficFormat::kRecordHeaderSize <= segment.used) {
+                const char* p = segment.base + offset_;
+                uint32_t length = 0;
+                memcpy(&frame.timestamp_ns, p, 8);
+                memcpy(&length, p + 8, 4);
+                size_t size = TrafficFormat::align(TrafficFormat::kRecordHeaderSize + length);
+                if (offset_ + size <= segment.used) {
+                    frame.direction = static_cast<TrafficDirection>(p[12]);
+                    frame.opcode = static_cast<uint8_t>(p[13]);
+                    frame.fin = p[14] != 0;
+                    frame.rsv = static_cast<uint8_t>(p[15] & 0x07);
+                    memcpy(&frame.steady_ns, p + 16, 8);
+                    frame.data = p + TrafficFormat::kRecordHeaderSize;
+                    frame.length = length;
+                    offset_ += size;
+                    return true;
+                }
+            }
+            ++segment_;
+            offset_ = TrafficFormat::kHeaderSize;
+        }
+        return false;
+    }
+
+private:
+    struct Segment {
+        const char* base = nullptr;
+        size_t size = 0;
+        uint64_t used = 0;
+    };
+
+    std::vector<Segment> segments_;
+    size_t segment_;
+    size_t offset_;
+};
+
+// 客户端的编译期策略：传输、压缩和回调投递方式作为模板参数，未使用的分支在编译期消除，
+// 热点路径上的调用可以内联。WebSocketClient为默认组合，行为与运行时配置一致
+
+// 传输策略：按URL协议选择明文或TLS(默认)
+struct AutoTransport {
+    typedef NetworkConnection Connection;
+    static bool accepts(const std::string&) { return true; }
+    static bool useTls(const std::string& scheme) { return scheme == "wss"; }
+};
+
+// 只允许ws://，不建立TLS
+struct PlainTransport {
+    typedef PlainConnection Connection;
+    static bool accepts(const std::string& scheme) { return scheme == "ws"; }
+    static bool useTls(const std::string&) { return false; }
+};
+
+// 只允许wss://
+struct TlsTransport {
+    typedef NetworkConnection Connection;
+    static bool accepts(const std::string& scheme) { return scheme == "wss"; }
+    static bool useTls(const std::string&) { return true; }
+};
+
+// 压缩策略：不压缩，握手不协商permessage-deflate
+struct NoCompression {
+    static const bool available = false;
+
+    bool enabled(const WebSocketConfig&) const { return false; }
+    void configure(const WebSocketConfig&, const DeflateParams&, bool) {}
+
+    WebSocketResult compress(const std::string&, std::string&) {
+        return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Compression not available");
+    }
+    WebSocketResult decompress(const std::string&, std::string&) {
+        return WebSocketResult(ResultCode::COMPRESSION_ERROR, "Compression not available");
+    }
+
+    size_t pendingSend() const { return 0; }
+    size_t pendingReceive() const { return 0; }
+    template <typename Task> void postSend(Task&&) {}
+    template <typename Task> void postReceive(Task&&) {}
+    void waitIdle() {}
+};
+
+#ifdef USE_ZLIB
+// permessage-deflate，是否启用仍由WebSocketConfig::enableCompression决定
+class DeflateCompression {
+public:
+    static const bool available = true;
+
+    bool enabled(const WebSocketConfig& config) const { return config.isCompressionEnabled(); }
+
+    // 每个连接按握手协商的参数使用新的压缩上下文，dictionary表示是否启用预置字典
+    void configure(const WebSocketConfig& config, const DeflateParams& params, bool dictionary) {
+        compression_.configure(config.getCompressionLevel(), config.getCompressionMemLevel(), params,
+                               dictionary ? config.getCompressionDictionary() : std::string());
+        compression_.setMaxMessageSize(config.getMaxMessageSize());
+    }
+
+    WebSocketResult compress(const std::string& data, std::string& result) { return compression_.compress(data, result); }
+    WebSocketResult decompress(const std::string& data, std::string& result) { return compression_.decompress(data, result); }
+
+    // 大消息在共享线程池上压缩/解压，发送和接收各用一个串行执行器保持顺序
+    size_t pendingSend() const { return send_strand_.pending(); }
+    size_t pendingReceive() const { return recv_strand_.pending(); }
+    template <typename Task> void postSend(Task&& task) { send_strand_.post(std::forward<Task>(task)); }
+    template <typename Task> void postReceive(Task&& task) { recv_strand_.post(std::forward<Task>(task)); }
+
+    void waitIdle() {
+        send_strand_.waitIdle();
+        recv_strand_.waitIdle();
+    }
+
+private:
+    Compression compression_;
+    // 放在最后以便析构时最先等待任务结束
+    SerialExecutor send_strand_;
+    SerialExecutor recv_strand_;
+};
+
+typedef DeflateCompression DefaultCompression;
+#else
+typedef NoCompression DefaultCompression;
+#endif
+
+// 投递策略：在接收线程上直接调用回调，省去投递线程和每条消息的任务分配，回调耗时会直接拖慢接收
+struct InlineDispatch {
+    static const bool is_inline = true;
+
+    void start() {}
+    void stop() {}
+    template <typename Task> void post(Task&& task) { task(); }
+};
+
+// 在单独的投递线程上按顺序调用回调(默认)
+class ExecutorDispatch {
+public:
+    static const bool is_inline = false;
+
+    void start() { runner_.start(); }
+    void stop() { runner_.stop(); }
+    template <typename Task> void post(Task&& task) { runner_.push_task(std::forward<Task>(task)); }
+
+private:
+    TaskRunner runner_;
+};
+
+// WebSocket客户端主类
+template <typename Transport = AutoTransport, typename CompressionPolicy = DefaultCompression,
+          typename Dispatch = ExecutorDispatch>
+class BasicWebSocketClient {
+public:
+    BasicWebSocketClient() : state_(WebSocketState::CLOSED), fragment_type_(FrameType::CONTINUATION), receiving_(false) {
+        updateConfig(WebSocketConfig());
+    }
+
+    explicit BasicWebSocketClient(const WebSocketConfig& config) : state_(WebSocketState::CLOSED), fragment_type_(FrameType::CONTINUATION), receiving_(false) {
+        updateConfig(config);
+    }
+
+    ~BasicWebSocketClient() {
+        // 先等待进行中的connect_async结束
+        task_runner_.stop();
+        disconnect();
+    }
+
+    // 设置回调函数
+    void setOnMsgText(std::function<void(const std::string&)> callback) { text_message_callback_.set(std::move(callback)); }
+    void setOnMsgBinary(std::function<void(const std::vector<uint8_t>&)> callback) { binary_message_callback_.set(std::move(callback)); }
+    void setOnError(std::function<void(const std::string& reason)> callback) { error_callback_.set(std::move(callback)); }
+    void setOnOpen(std::function<void()> callback) { open_callback_.set(std::move(callback)); }
+    void setOnClose(std::function<void(const std::string& reason)> callback) { close_callback_.set(std::move(callback)); }
+    void setOnStateChange(std::function<void(WebSocketState)> callback) { state_callback_.set(std::move(callback)); }
+
+    // 连接方法
+    WebSocketResult connect_sync(const std::string& url) noexcept {
+        WebSocketState state = WebSocketState::CLOSED;
+        if (!state_.compare_exchange_strong(state, WebSocketState::CONNECTING)) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is already connecting");
+        }
+        notifyState(WebSocketState::CONNECTING);
+
+        WebSocketResult res = openConnection(url);
+        if (!res) {
+            connection_.close();
+            setState(WebSocketState::CLOSED);
+            return res;
+        }
+
+        // 启动工作线程
+        startWorker();
+
+        setState(WebSocketState::OPEN);
+        onOpen();
+
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+    void connect_async(const std::string& url, const std::function<void(WebSocketResult)>& callback) noexcept {
+        task_runner_.start();
+        task_runner_.push_task([this, url, callback] {
+             callback(connect_sync(url));
+        });
+    }
+
+    // 断开连接
+    void disconnect() {
+        if (state_ == WebSocketState::OPEN) {
+            setState(WebSocketState::CLOSING);
+            
+            // 发送关闭帧
+            sendCloseFrame();
+        }
+
+        // 停止工作线程
+        stopWorker();
+
+        setState(WebSocketState::CLOSED);
+        
+        // 关闭网络连接
+        connection_.close();
+    }
+
+    // 发送消息
+    WebSocketResult send(const std::string& message, SendPriority priority = SendPriority::NORMAL) {
+        if (state_ != WebSocketState::OPEN) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+        }
+
+        return sendFrameSync(FrameType::TEXT, message, priority);
+    }
+
+    WebSocketResult sendBinary(const std::string& data, SendPriority priority = SendPriority::NORMAL) {
+        if (state_ != WebSocketState::OPEN) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+        }
+
+        return sendFrameSync(FrameType::BINARY, data, priority);
+    }
+
+    // 异步发送，入队后立即返回，completion在写入socket、失败或被丢弃时于发送线程调用
+    WebSocketResult sendAsync(const std::string& message, SendCompletion completion = nullptr,
+                              SendPriority priority = SendPriority::NORMAL) {
+        if (state_ != WebSocketState::OPEN) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+        }
+
+        return sendFrame(FrameType::TEXT, message, completion, priority);
+    }
+
+    WebSocketResult sendBinaryAsync(const std::string& data, SendCompletion completion = nullptr,
+                                    SendPriority priority = SendPriority::NORMAL) {
+        if (state_ != WebSocketState::OPEN) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+        }
+
+        return sendFrame(FrameType::BINARY, data, completion, priority);
+    }
+
+    // 已入队但尚未写入socket的字节数
+    size_t bufferedAmount() const { return send_queue_.bufferedAmount(); }
+
+    // 发送ping
+    WebSocketResult ping(const std::string& data = "") {
+        if (state_ != WebSocketState::OPEN) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+        }
+
+        return sendFrameSync(FrameType::PING, data, SendPriority::CONTROL);
+    }
+
+    // 异步ping，入队后立即返回
+    WebSocketResult pingAsync(const std::string& data = "", SendCompletion completion = nullptr) {
+        if (state_ != WebSocketState::OPEN) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+        }
+
+        return sendFrame(FrameType::PING, data, completion, SendPriority::CONTROL);
+    }
+
+    // 获取状态
+    WebSocketState getState() const { return state_; }
+    const WebSocketConfig& getConfig() const { return config_; }
+
+    // 更新配置，压缩策略不支持压缩时始终关闭压缩，握手也不会提出permessage-deflate
+    void updateConfig(const WebSocketConfig& config) {
+        config_ = config;
+        if (!CompressionPolicy::available) config_.enableCompression(false);
+    }
+
+    // 最近一次收到pong的时间，从未收到时为time_point()
+    std::chrono::steady_clock::time_point getLastPongTime() const {
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(last_pong_ns_.load()));
+    }
+
+    // 获取接收流控统计
+    ReceiveFlowStats getReceiveFlowStats() const { return flow_control_.stats(); }
+
+    // 离线回放录制的流量：不建立连接，录制的入站帧经过与在线接收相同的handleFrame处理，
+    // 消息通过已设置的回调或接收队列投递；压缩相关配置需与录制时一致
+    WebSocketResult replay(const std::string& prefix, ReplayPace pace = ReplayPace::MAX_SPEED) {
+        if (state_ != WebSocketState::CLOSED) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "Cannot replay while connected");
+        }
+
+        TrafficReplayer replayer;
+        WebSocketResult res = replayer.open(prefix);
+        if (!res) {
+            return res;
+        }
+
+        // 只启动投递，不启动收发线程，发送队列关闭后控制帧的应答直接丢弃
+        send_queue_.close();
+        flow_control_.setWatermarks(config_.getReceiveHighWatermark(), config_.getReceiveLowWatermark());
+        flow_control_.reset();
+        inbound_queue_.reset();
+        dispatch_.start();
+        fragment_type_ = FrameType::CONTINUATION;
+        fragment_buffer_.clear();
+        // 按配置假定握手时的协商结果
+        compression_active_ = codec_.enabled(config_);
+        dictionary_active_ = compression_active_ && !config_.getCompressionDictionaryId().empty();
+        deflate_params_ = WebSocketHandshake::offeredDeflateParams(config_);
+        codec_.configure(config_, deflate_params_, dictionary_active_);
+        offload_failed_ = false;
+
+        WebSocketResult result(ResultCode::SUCCESS, "");
+        RecordedFrame recorded;
+        int64_t first_steady = 0;
+        bool started = false;
+        auto start = std::chrono::steady_clock::now();
+        while (replayer.next(recorded)) {
+            if (recorded.direction != TrafficDirection::INBOUND) {
+                continue;
+            }
+
+            if (pace == ReplayPace::ORIGINAL) {
+                if (!started) {
+                    first_steady = recorded.steady_ns;
+                    started = true;
+                }
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(recorded.steady_ns - first_steady));
+            }
+
+            if (!flow_control_.waitForCapacity()) {
+                break;
+            }
+
+            WebSocketFrame frame;
+            frame.setFin(recorded.fin);
+            frame.setOpcode(recorded.opcode);
+            frame.setRsv(recorded.rsv);
+            frame.setPayload(std::string(recorded.data, recorded.length));
+            if (!handleFrame(frame) || offload_failed_) {
+                result = WebSocketResult(ResultCode::FRAME_ERROR, "Replay stopped at an invalid frame");
+                break;
+            }
+        }
+
+        // 等待剩余消息投递完
+        codec_.waitIdle();
+        dispatch_.stop();
+        flow_control_.stop();
+        inbound_queue_.close();
+        state_ = WebSocketState::CLOSED;
+        return result;
+    }
+
+    // 当前连接是否与服务端协商启用了预置字典
+    bool isCompressionDictionaryActive() const {
+        return dictionary_active_;
+    }
+
+    // 拉取接口：一次取出最多max_count条消息，需要DeliveryMode::QUEUE
+    // timeout_ms为队列为空时的等待时间，0表示不等待，小于0表示一直等待；返回取出的消息数
+    size_t receive_batch(Message* out, size_t max_count, int timeout_ms) {
+        if (config_.getDeliveryMode() != DeliveryMode::QUEUE || max_count == 0) {
+            return 0;
+        }
+
+        size_t count = inbound_queue_.popBatch(out, max_count, timeout_ms);
+        if (count > 0) {
+            flow_control_.onDelivered(count);
+        }
+        return count;
+    }
+
+    size_t receive_batch(std::vector<Message>& out, int timeout_ms) {
+        return receive_batch(out.data(), out.size(), timeout_ms);
+    }
+
+#ifdef __cpp_lib_span
+    size_t receive_batch(std::span<Message> out, int timeout_ms) {
+        return receive_batch(out.data(), out.size(), timeout_ms);
+    }
+#endif
+
+#ifdef WEBSOCKET_HAS_COROUTINES
+    // 协程接口：操作完成后协程在完成该操作的库线程(回调/发送/I/O/定时器线程)上恢复，
+    // 恢复后的代码不应调用同步的send()/disconnect()等阻塞接口
+    class ConnectAwaitable {
+    public:
+        ConnectAwaitable(BasicWebSocketClient& client, const std::string& url, int timeout_ms, const CancellationToken& token)
+            : client_(client), url_(url), timeout_ms_(timeout_ms), token_(token), state_(std::make_shared<AwaitState>()) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // 超时或取消后连接仍在后台继续，调用者需自行disconnect()
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::shared_ptr<AwaitState> state = state_;
+            int timeout_ms = timeout_ms_;
+            CancellationToken token = token_;
+
+            state->setHandle(handle);
+            client_.connect_async(url_, [state](WebSocketResult result) {
+                state->complete(result);
+            });
+            state->arm(state, timeout_ms, token);
+            return true;
+        }
+
+        WebSocketResult await_resume() { return state_->result(); }
+
+    private:
+        BasicWebSocketClient& client_;
+        std::string url_;
+        int timeout_ms_;
+        CancellationToken token_;
+        std::shared_ptr<AwaitState> state_;
+    };
+
+    class SendAwaitable {
+    public:
+        SendAwaitable(BasicWebSocketClient& client, FrameType type, const std::string& payload, SendPriority priority,
+                      int timeout_ms, const CancellationToken& token)
+            : client_(client), type_(type), payload_(payload), priority_(priority), timeout_ms_(timeout_ms), token_(token),
+              state_(std::make_shared<AwaitState>()) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // 超时或取消只提前恢复协程，已入队的消息仍会发送
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::shared_ptr<AwaitState> state = state_;
+            int timeout_ms = timeout_ms_;
+            CancellationToken token = token_;
+
+            state->setHandle(handle);
+            WebSocketResult result(ResultCode::INVALID_STATE, "WebSocket is not open");
+            if (client_.state_ == WebSocketState::OPEN) {
+                result = client_.sendFrame(type_, payload_, [state](const WebSocketResult& res) {
+                    state->complete(res);
+                }, priority_);
+            }
+            if (!result && state->completeInline(result)) {
+                return false;
+            }
+
+            state->arm(state, timeout_ms, token);
+            return true;
+        }
+
+        WebSocketResult await_resume() { return state_->result(); }
+
+    private:
+        BasicWebSocketClient& client_;
+        FrameType type_;
+        std::string payload_;
+        SendPriority priority_;
+        int timeout_ms_;
+        CancellationToken token_;
+        std::shared_ptr<AwaitState> state_;
+    };
+
+    class ReceiveAwaitable {
+    public:
+        ReceiveAwaitable(BasicWebSocketClient& client, int timeout_ms, const CancellationToken& token)
+            : client_(client), timeout_ms_(timeout_ms), token_(token), ready_(false),
+              result_(ResultCode::SUCCESS, "") {}
+
+        // 队列中已有消息时不挂起
+        bool await_ready() {
+            if (client_.config_.getDeliveryMode() != DeliveryMode::QUEUE) {
+                result_ = WebSocketResult(ResultCode::INVALID_STATE, "receive() requires DeliveryMode::QUEUE");
+                ready_ = true;
+            } else if (client_.inbound_queue_.tryPop(message_)) {
+                client_.flow_control_.onDelivered();
+                ready_ = true;
+            }
+            return ready_;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            state_ = std::make_shared<AwaitState>();
+            std::shared_ptr<AwaitState> state = state_;
+            int timeout_ms = timeout_ms_;
+            CancellationToken token = token_;
+            BasicWebSocketClient& client = client_;
+
+            state->setHandle(handle);
+            Message message;
+            switch (client.inbound_queue_.popOrWait(message, state)) {
+                case InboundQueue::READY:
+                    client.flow_control_.onDelivered();
+                    state->completeInline(WebSocketResult(ResultCode::SUCCESS, ""));
+                    state->message() = std::move(message);
+                    return false;
+                case InboundQueue::BUSY:
+                    state->completeInline(WebSocketResult(ResultCode::INVALID_STATE, "Another receive() is pending"));
+                    return false;
+                case InboundQueue::CLOSED:
+                    state->completeInline(WebSocketResult(ResultCode::CLOSED, "WebSocket is closed"));
+                    return false;
+                case InboundQueue::WAITING:
+                    break;
+            }
+
+            state->arm(state, timeout_ms, token, [&client, state] {
+                client.inbound_queue_.cancelWait(state.get());
+            });
+            return true;
+        }
+
+        ReceiveResult await_resume() {
+            if (ready_) {
+                return ReceiveResult{result_, std::move(message_)};
+            }
+            return ReceiveResult{state_->result(), std::move(state_->message())};
+        }
+
+    private:
+        BasicWebSocketClient& client_;
+        int timeout_ms_;
+        CancellationToken token_;
+        bool ready_;
+        WebSocketResult result_;
+        Message message_;
+        std::shared_ptr<AwaitState> state_;
+    };
+
+    // co_await client.connect(url)
+    ConnectAwaitable connect(const std::string& url, int timeout_ms = -1, const CancellationToken& token = CancellationToken()) {
+        return ConnectAwaitable(*this, url, timeout_ms, token);
+    }
+
+    // co_await client.asyncSend(message)，send()已是同步接口，故另起名
+    SendAwaitable asyncSend(const std::string& message, SendPriority priority = SendPriority::NORMAL,
+                            int timeout_ms = -1, const CancellationToken& token = CancellationToken()) {
+        return SendAwaitable(*this, FrameType::TEXT, message, priority, timeout_ms, token);
+    }
+
+    SendAwaitable asyncSendBinary(const std::string& data, SendPriority priority = SendPriority::NORMAL,
+                                  int timeout_ms = -1, const CancellationToken& token = CancellationToken()) {
+        return SendAwaitable(*this, FrameType::BINARY, data, priority, timeout_ms, token);
+    }
+
+    // co_await client.receive()，需要DeliveryMode::QUEUE，同一时刻只允许一个等待者
+    ReceiveAwaitable receive(int timeout_ms = -1, const CancellationToken& token = CancellationToken()) {
+        return ReceiveAwaitable(*this, timeout_ms, token);
+    }
+#endif
+
+private:
+
+    // 解析URL、建立连接并完成握手，失败时由调用方关闭连接并恢复状态
+    WebSocketResult openConnection(const std::string& url) noexcept {
+        URL u;
+        WebSocketResult res = u.parse(url);
+        if (!res) {
+            return res;
+        }
+
+        // 回收上次断线遗留的工作线程
+        stopWorker();
+        connection_.close();
+
+        // 首次连接时开始录制，重连继续写入同一组分段
+        if (!config_.getRecordingPrefix().empty() && !recorder_.isOpen()) {
+            res = recorder_.open(config_.getRecordingPrefix(), config_.getRecordingSegmentBytes());
+            if (!res) {
+                return res;
+            }
+        }
+
+        // 连接网络
+        if (!Transport::accepts(u.scheme())) {
+            return WebSocketResult(ResultCode::URL_ERROR, "Scheme not supported by this transport: " + u.scheme());
+        }
+        connection_.setBusyPoll(config_.getBusyPoll());
+        connection_.setSocketOptions(config_.getSocketOptions());
+        res = connection_.connect(u.host(), u.port(), Transport::useTls(u.scheme()), config_.getTimeout());
+        if (!res) {
+            return res;
+        }
+
+        // 执行握手
+        return performHandshake(u);
+    }
+
+    WebSocketResult performHandshake(const URL& url) noexcept {
+        // 发送握手请求
+        std::string request;
+        std::string accept_key;
+        WebSocketResult res = WebSocketHandshake::createHandshakeRequest(url, config_, request, accept_key);
+        if (!res) {
+            return res;
+        }
+        res = connection_.send(request, config_.getTimeout());
+        if (!res) {
+            return res;
+        }
+
+        // 接收握手响应，响应头之后的数据留在接收缓冲区交给帧解析
+        const size_t max_response_size = 64 * 1024;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.getTimeout());
+        recv_buffer_.clear();
+        size_t header_length = 0;
+        while (header_length == 0) {
+            if (recv_buffer_.size() > max_response_size) {
+                return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Handshake response too large");
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return WebSocketResult(ResultCode::TIMEOUT, "Handshake response timeout");
+            }
+            int remaining_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+
+            size_t scanned = recv_buffer_.size();
+            size_t readbytes = 0;
+            char* dst = recv_buffer_.prepare(0);
+            WebSocketResult res = connection_.receive(dst, static_cast<int>(recv_buffer_.writable()), readbytes, remaining_ms);
+            if (!res) {
+                return res;
+            }
+            recv_buffer_.commit(readbytes);
+            header_length = WebSocketHandshake::findHeaderEnd(recv_buffer_.data(), recv_buffer_.size(), scanned);
+        }
+
+        // 解析响应
+        std::string extensions;
+        WebSocketResult result = WebSocketHandshake::parseHandshakeResponse(recv_buffer_.data(), header_length, accept_key, &extensions);
+        recv_buffer_.consume(header_length);
+
+        if (!result) {
+            return result;
+        }
+
+        // 按服务端接受的permessage-deflate参数配置两个方向，服务端带回相同的字典id才启用预置字典
+        bool compression = false;
+        bool dictionary = false;
+        result = WebSocketHandshake::negotiateDeflate(extensions, config_, deflate_params_, compression, dictionary);
+        compression_active_ = result && compression;
+        dictionary_active_ = result && dictionary;
+        return result;
+    }
+
+    void startWorker() {
+        flow_control_.setWatermarks(config_.getReceiveHighWatermark(), config_.getReceiveLowWatermark());
+        flow_control_.reset();
+        dispatch_.start();
+
+        // 发送线程，重新打开上个连接关闭的发送队列
+        send_queue_.configure(config_.getMaxSendQueueBytes(), config_.getSendQueuePolicy());
+        send_queue_.reset();
+        send_thread_ = std::thread([this] { sendLoop(); });
+
+        // 每个连接使用新的压缩上下文
+        codec_.configure(config_, deflate_params_, dictionary_active_);
+        offload_failed_ = false;
+
+        // 接收线程，清空上个连接未完成的分片消息
+        fragment_type_ = FrameType::CONTINUATION;
+        fragment_buffer_.clear();
+        inbound_queue_.reset();
+        receiving_ = true;
+        receive_thread_ = std::thread([this] { receiveLoop(); });
+    }
+
+    void stopWorker() {
+        // 先写完已入队的消息(包括关闭帧)
+        send_queue_.close();
+        if (send_thread_.joinable() && send_thread_.get_id() != std::this_thread::get_id()) {
+            send_thread_.join();
+        }
+
+        receiving_ = false;
+        flow_control_.stop();
+        if (receive_thread_.joinable() && receive_thread_.get_id() != std::this_thread::get_id()) {
+            receive_thread_.join();
+        }
+
+        // 队列已关闭，未完成的压缩任务入队失败后通知completion
+        codec_.waitIdle();
+
+        dispatch_.stop();
+        inbound_queue_.close();
+    }
+
+    void sendLoop() {
+        OutboundMessage current;     // 正在分片发送的数据消息
+        bool has_current = false;
+
+        while (true) {
+            OutboundMessage message;
+            if (has_current) {
+                // 数据消息的分片之间只允许插入控制帧
+                if (send_queue_.popControl(message)) {
+                    WebSocketResult result = writeMessage(message);
+                    if (!result) {
+                        // 分片未写完的消息不在队列中，需单独以相同错误完成
+                        send_queue_.complete(current.payload.length() - current.offset);
+                        if (current.completion) {
+                            current.completion(result);
+                        }
+                        break;
+                    }
+                    continue;
+                }
+
+                if (!writeMessage(current)) {
+                    break;
+                }
+                has_current = current.offset < current.payload.length();
+                continue;
+            }
+
+            if (!send_queue_.pop(message)) {
+                break;
+            }
+
+            if (message.priority == SendPriority::CONTROL) {
+                if (!writeMessage(message)) {
+                    break;
+                }
+            } else {
+                current = std::move(message);
+                if (current.compress) {
+                    bool written = true;
+                    if (!compressMessage(current, written)) {
+                        if (!written) {
+                            break;
+                        }
+                        continue;
+                    }
+                }
+                if (!writeMessage(current)) {
+                    break;
+                }
+                has_current = current.offset < current.payload.length();
+            }
+        }
+    }
+
+    // 线程池上的压缩任务，载荷移入任务中，发送线程出错退出时任务仍可安全完成
+    struct CompressJob {
+        std::string input;
+        std::string output;
+        WebSocketResult result{ResultCode::SUCCESS, ""};
+        std::atomic<bool> done{false};
+    };
+
+    // 在发送线程上按出队顺序压缩，压缩上下文的顺序与实际发送顺序一致，丢弃的消息也不会进入上下文。
+    // 大消息交给线程池压缩，等待期间继续发送控制帧。压缩失败时以错误完成该消息并返回false，
+    // written为false表示等待期间写控制帧失败，连接已异常
+    bool compressMessage(OutboundMessage& message, bool& written) {
+        written = true;
+        message.compress = false;
+        size_t raw_size = message.payload.length();
+
+        WebSocketResult res(ResultCode::SUCCESS, "");
+        size_t threshold = config_.getCompressionOffloadThreshold();
+        if (threshold > 0 && raw_size >= threshold) {
+            auto job = std::make_shared<CompressJob>();
+            job->input.swap(message.payload);
+            codec_.postSend([this, job] {
+                job->result = codec_.compress(job->input, job->output);
+                job->done = true;
+                send_queue_.wake();
+            });
+
+            OutboundMessage control;
+            while (send_queue_.waitControl(control, job->done)) {
+                WebSocketResult result = writeMessage(control);
+                if (!result) {
+                    // 连接已异常，剩余消息已由writeMessage以错误完成
+                    written = false;
+                    send_queue_.complete(raw_size);
+                    if (message.completion) {
+                        message.completion(result);
+                    }
+                    return false;
+                }
+            }
+            res = job->result;
+            message.payload.swap(job->output);
+        } else {
+            std::string compressed;
+            res = codec_.compress(message.payload, compressed);
+            message.payload.swap(compressed);
+        }
+
+        if (!res) {
+            send_queue_.complete(raw_size);
+            if (message.completion) {
+                message.completion(res);
+            }
+            return false;
+        }
+
+        send_queue_.resize(raw_size, message.payload.length());
+        message.compressed = true;
+        return true;
+    }
+
+    // 写出消息的下一帧，控制帧和不分片的消息一次写完；返回失败表示连接异常
+    WebSocketResult writeMessage(OutboundMessage& message) {
+        size_t fragment_size = config_.getSendFragmentSize();
+        size_t remaining = message.payload.length() - message.offset;
+        size_t length = remaining;
+        if (message.priority != SendPriority::CONTROL && fragment_size > 0 && remaining > fragment_size) {
+            length = fragment_size;
+        }
+
+        WebSocketFrame frame;
+        frame.setFin(length == remaining);
+        frame.setOpcode(static_cast<uint8_t>(message.offset == 0 ? message.type : FrameType::CONTINUATION));
+        frame.setRsv1(message.offset == 0 && message.compressed);
+        frame.setMasked(true);
+        if (message.offset == 0 && length == remaining) {
+            frame.setPayload(message.payload);
+        } else {
+            frame.setPayload(message.payload.substr(message.offset, length));
+        }
+        WebSocketResult result(ResultCode::SUCCESS, "");
+        std::string mask_key = Utils::generateMaskKey();
+        if (mask_key.empty()) {
+            // 不能用可预测的掩码发送，按连接异常处理
+            result = WebSocketResult(ResultCode::CONNECTION_ERROR, "Failed to generate mask key");
+        } else {
+            frame.setMaskKey(mask_key);
+            result = connection_.send(frame.serialize(), config_.getTimeout());
+        }
+        if (result && recorder_.isOpen()) {
+            recorder_.record(TrafficDirection::OUTBOUND, frame.getOpcode(), frame.isFin(), frame.getRsv(),
+                             message.payload.data() + message.offset, length);
+        }
+        message.offset += length;
+        // 写失败时剩余部分不会再发送，一并扣除
+        send_queue_.complete(result ? length : remaining);
+
+        if (result && message.offset < message.payload.length()) {
+            return result;
+        }
+
+        if (message.completion) {
+            message.completion(result);
+        }
+
+        if (!result) {
+            // 连接异常，剩余消息全部以相同错误完成
+            send_queue_.close();
+            for (auto& m : send_queue_.drain()) {
+                if (m.completion) {
+                    m.completion(result);
+                }
+            }
+            onError(result);
+        }
+        return result;
+    }
+
+    void receiveLoop() {
+        const BusyPollOptions& busy_poll = config_.getBusyPoll();
+        if (busy_poll.enabled && busy_poll.cpu >= 0) {
+            Utils::pinCurrentThread(busy_poll.cpu);
+        }
+
+        while (receiving_) {
+            // 线程池上解压失败时已发送关闭帧
+            if (offload_failed_) {
+                break;
+            }
+
+            // 消费者跟不上时暂停读取
+            if (!flow_control_.waitForCapacity()) {
+                break;
+            }
+
+            if (!receiveFrame()) {
+                break;
+            }
+        }
+
+        // 不是由stopWorker结束的，说明连接已断开或已失败
+        if (receiving_) {
+            receiving_ = false;
+            setState(WebSocketState::CLOSED);
+            onClose("Connection closed");
+        }
+    }
+
+    // 处理缓冲区中的一个完整帧，不足一帧时读一次socket，返回false表示停止接收
+    bool receiveFrame() {
+        uint64_t payload_length = 0;
+        size_t frame_size = WebSocketFrame::frameSize(recv_buffer_.data(), recv_buffer_.size(), payload_length);
+        if (frame_size != 0 && payload_length > config_.getMaxFrameSize()) {
+            return failConnection(1009, "Frame too large");
+        }
+
+        if (frame_size == 0 || recv_buffer_.size() < frame_size) {
+            // 整帧大小已知时一次预留足够空间，减少读取次数
+            size_t missing = frame_size > recv_buffer_.size() ? frame_size - recv_buffer_.size() : 0;
+            size_t readbytes = 0;
+            char* dst = recv_buffer_.prepare(missing);
+            // 带超时读取，以便及时响应stopWorker
+            WebSocketResult res = connection_.receive(dst, static_cast<int>(recv_buffer_.writable()), readbytes, 100);
+            if (!res) {
+                if (receiving_) {
+                    onError(res);
+                }
+                return false;
+            }
+            recv_buffer_.commit(readbytes);
+            return true;
+        }
+
+        // 解析帧
+        WebSocketFrame frame;
+        size_t consumed = 0;
+        WebSocketResult res = WebSocketFrame::parse(recv_buffer_.data(), frame_size, frame, consumed);
+        if (!res) {
+            return failConnection(1002, res.message());
+        }
+        recv_buffer_.consume(consumed);
+
+        if (recorder_.isOpen()) {
+            const std::string& payload = frame.getPayload();
+            recorder_.record(TrafficDirection::INBOUND, frame.getOpcode(), frame.isFin(), frame.getRsv(), payload.data(), payload.size());
+        }
+        return handleFrame(frame);
+    }
+
+    // 处理一帧，返回false表示连接已失败，停止接收
+    bool handleFrame(const WebSocketFrame& frame) {
+        FrameType type = static_cast<FrameType>(frame.getOpcode());
+
+        // RSV1只能出现在已协商压缩时数据消息的第一帧，RSV2/RSV3没有定义
+        if (frame.getRsv() != 0) {
+            bool first_data_frame = type == FrameType::TEXT || type == FrameType::BINARY;
+            if (frame.getRsv() != 0x04 || !first_data_frame || !compression_active_) {
+                return failConnection(1002, "Unexpected RSV bits");
+            }
+        }
+
+        switch (type) {
+            case FrameType::TEXT:
+            case FrameType::BINARY:
+            case FrameType::CONTINUATION: {
+                if (type == FrameType::CONTINUATION) {
+                    if (fragment_type_ == FrameType::CONTINUATION) {
+                        return failConnection(1002, "Unexpected continuation frame");
+                    }
+                } else {
+                    if (fragment_type_ != FrameType::CONTINUATION) {
+                        return failConnection(1002, "Expected continuation frame");
+                    }
+                    fragment_type_ = type;
+                    fragment_compressed_ = frame.isRsv1();
+                    utf8_validator_.reset();
+                }
+
+                bool compressed = fragment_compressed_;
+                bool validate = fragment_type_ == FrameType::TEXT && config_.isUtf8ValidationEnabled();
+
+                // 未压缩时逐分片校验，非法数据无需等到消息结束即可关闭连接
+                const std::string& data = frame.getPayload();
+                if (validate && !compressed && !utf8_validator_.feed(data)) {
+                    return failConnection(1007, "Invalid UTF-8 in text message");
+                }
+
+                // 分片累计的大小同样受消息上限约束，否则单帧不超过上限的分片可以无限累积
+                size_t max_size = config_.getMaxMessageSize();
+                if (max_size > 0 && fragment_buffer_.size() + data.size() > max_size) {
+                    std::string().swap(fragment_buffer_);
+                    fragment_type_ = FrameType::CONTINUATION;
+                    return failConnection(1009, "Message too large");
+                }
+
+                if (!frame.isFin()) {
+                    fragment_buffer_.append(data);
+                    return true;
+                }
+
+                std::string payload;
+                if (fragment_buffer_.empty()) {
+                    payload = data;
+                } else {
+                    fragment_buffer_.append(data);
+                    payload.swap(fragment_buffer_);
+                }
+                FrameType message_type = fragment_type_;
+                fragment_type_ = FrameType::CONTINUATION;
+
+                // 大消息或前面还有消息在线程池上解压时，交给线程池以保持顺序
+                size_t threshold = config_.getCompressionOffloadThreshold();
+                if (compressed && !payload.empty() && threshold > 0 &&
+                    (payload.size() >= threshold || codec_.pendingReceive() > 0)) {
+                    decompressAsync(message_type, std::move(payload), validate);
+                    return true;
+                }
+
+                if (compressed && !payload.empty()) {
+                    std::string decompressed;
+                    WebSocketResult res = codec_.decompress(payload, decompressed);
+                    if (!res) {
+                        return failConnection(res.code() == ResultCode::BUFFER_OVERFLOW ? 1009 : 1002, res.message());
+                    }
+                    payload.swap(decompressed);
+                    if (validate) {
+                        utf8_validator_.feed(payload);
+                    }
+                }
+
+                if (validate && !utf8_validator_.finish()) {
+                    return failConnection(1007, "Invalid UTF-8 in text message");
+                }
+
+                deliverMessage(message_type, std::move(payload));
+                break;
+            }
+            case FrameType::CLOSE: {
+                setState(WebSocketState::CLOSING);
+                sendCloseFrame();
+                setState(WebSocketState::CLOSED);
+                break;
+            }
+            case FrameType::PING: {
+                sendFrame(FrameType::PONG, frame.getPayload());
+                break;
+            }
+            case FrameType::PONG: {
+                last_pong_ns_ = std::chrono::steady_clock::now().time_since_epoch().count();
+                break;
+            }
+            default:
+                break;
+        }
+        return true;
+    }
+
+    // 协议错误：发送关闭帧后停止接收
+    bool failConnection(uint16_t code, const std::string& reason) {
+        setState(WebSocketState::CLOSING);
+        sendCloseFrame(code, reason);
+        onError(WebSocketResult(ResultCode::FRAME_ERROR, reason));
+        return false;
+    }
+
+    // 在线程池上解压并投递，提交时即计入未投递消息数，使流控能限制排队的大消息
+    void decompressAsync(FrameType type, std::string payload, bool validate) {
+        flow_control_.onEnqueue();
+        auto data = std::make_shared<std::string>(std::move(payload));
+        codec_.postReceive([this, type, data, validate] {
+            if (offload_failed_) {
+                flow_control_.onDelivered();
+                return;
+            }
+
+            std::string decompressed;
+            WebSocketResult res = codec_.decompress(*data, decompressed);
+            if (!res) {
+                offload_failed_ = true;
+                flow_control_.onDelivered();
+                failConnection(res.code() == ResultCode::BUFFER_OVERFLOW ? 1009 : 1002, res.message());
+                return;
+            }
+            if (validate && !Utf8Validator::validate(decompressed.data(), decompressed.size())) {
+                offload_failed_ = true;
+                flow_control_.onDelivered();
+                failConnection(1007, "Invalid UTF-8 in text message");
+                return;
+            }
+            deliverMessage(type, std::move(decompressed), true);
+        });
+    }
+
+    // 交给回调线程或接收队列投递，计入未投递消息数，counted表示提交解压任务时已经计入
+    void deliverMessage(FrameType type, std::string payload, bool counted = false) {
+        if (!counted) {
+            flow_control_.onEnqueue();
+        }
+        if (config_.getDeliveryMode() == DeliveryMode::QUEUE) {
+            Message message;
+            message.type = type;
+            message.data = std::move(payload);
+            if (inbound_queue_.push(std::move(message))) {
+                flow_control_.onDelivered();
+            }
+            return;
+        }
+
+        if (Dispatch::is_inline) {
+            dispatchMessage(type, payload);
+            return;
+        }
+        dispatch_.post(DispatchTask(this, type, std::move(payload)));
+    }
+
+    // 投递任务，载荷移入任务中而不是按值捕获拷贝一份(C++11的lambda不能移动捕获)
+    struct DispatchTask {
+        DispatchTask(BasicWebSocketClient* client, FrameType type, std::string&& payload)
+            : client(client), type(type), payload(std::move(payload)) {}
+        void operator()() { client->dispatchMessage(type, payload); }
+
+        BasicWebSocketClient* client;
+        FrameType type;
+        std::string payload;
+    };
+
+    // 回调抛出异常时也要计入已投递，否则流控会一直认为有消息未投递而停止读取
+    struct DeliveredNotifier {
+        explicit DeliveredNotifier(ReceiveFlowControl& flow) : flow(flow) {}
+        ~DeliveredNotifier() { flow.onDelivered(); }
+        ReceiveFlowControl& flow;
+    };
+
+    void dispatchMessage(FrameType type, const std::string& payload) {
+        DeliveredNotifier notifier(flow_control_);
+        if (type == FrameType::TEXT) {
+            onTextMessage(payload);
+        } else {
+            onBinaryMessage(std::vector<uint8_t>(payload.begin(), payload.end()));
+        }
+    }
+
+    // 放入发送队列，控制帧总是走CONTROL通道且不受队列容量限制
+    WebSocketResult sendFrame(FrameType type, const std::string& payload, SendCompletion completion = nullptr,
+                              SendPriority priority = SendPriority::NORMAL) {
+        bool control = (type == FrameType::CLOSE || type == FrameType::PING || type == FrameType::PONG);
+        if (control) {
+            priority = SendPriority::CONTROL;
+        } else if (priority == SendPriority::CONTROL) {
+            priority = SendPriority::URGENT;
+        }
+
+        OutboundMessage message;
+        message.type = type;
+        message.priority = priority;
+        message.payload = payload;
+        message.completion = completion;
+        // 压缩上下文跨消息共享，由发送线程按实际发送顺序压缩
+        message.compress = compression_active_ && !payload.empty() && !control;
+
+        return send_queue_.push(std::move(message), config_.getTimeout());
+    }
+
+    // 入队并等待写入socket
+    WebSocketResult sendFrameSync(FrameType type, const std::string& payload, SendPriority priority) {
+        // 发送线程上(如completion回调中)等待自己写出会死锁
+        if (std::this_thread::get_id() == send_thread_.get_id()) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "Synchronous send on the send thread, use sendAsync");
+        }
+
+        auto promise = std::make_shared<std::promise<WebSocketResult>>();
+        std::future<WebSocketResult> future = promise->get_future();
+
+        WebSocketResult result = sendFrame(type, payload, [promise](const WebSocketResult& res) {
+            promise->set_value(res);
+        }, priority);
+        if (!result) {
+            return result;
+        }
+
+        return future.get();
+    }
+
+    // 关闭帧载荷为2字节状态码(网络字节序)加原因
+    void sendCloseFrame(uint16_t code = 1000, const std::string& reason = "") {
+        std::string payload;
+        payload.push_back(static_cast<char>((code >> 8) & 0xFF));
+        payload.push_back(static_cast<char>(code & 0xFF));
+        payload.append(reason, 0, 123);
+        sendFrame(FrameType::CLOSE, payload);
+    }
+
+    void onError(const WebSocketResult& result) {
+        error_callback_(result.message());
+    }
+
+    void onOpen() {
+        open_callback_();
+    }
+
+    void onClose(const std::string& reason) {
+        close_callback_(reason);
+    }
+
+    void onTextMessage(const std::string& message) {
+        text_message_callback_(message);
+    }
+
+    void onBinaryMessage(const std::vector<uint8_t>& message) {
+        binary_message_callback_(message);
+    }
+
+    void setState(WebSocketState state) {
+        if (state_.exchange(state) != state) {
+            notifyState(state);
+        }
+    }
+
+    void notifyState(WebSocketState state) {
+        state_callback_(state);
+    }
+
+    std::atomic<WebSocketState> state_;
+    WebSocketConfig config_;
+    typename Transport::Connection connection_;
+    // 握手协商的压缩参数，连接建立后只读
+    DeflateParams deflate_params_;
+    std::atomic<bool> compression_active_{false};
+    std::atomic<bool> dictionary_active_{false};
+
+    // 回调可在连接期间替换(如连接池归还时清除)
+    CallbackSlot<std::function<void(const std::string&)>> text_message_callback_;
+    CallbackSlot<std::function<void(const std::vector<uint8_t>&)>> binary_message_callback_;
+    CallbackSlot<std::function<void(const std::string&)>> error_callback_;
+    CallbackSlot<std::function<void()>> open_callback_;
+    CallbackSlot<std::function<void(const std::string&)>> close_callback_;
+    CallbackSlot<std::function<void(WebSocketState)>> state_callback_;
+
+    // connect_async在此线程上执行连接
+    TaskRunner task_runner_;
+
+    Dispatch dispatch_;
+
+    // 分片消息重组，CONTINUATION表示当前没有未完成的消息
+    FrameType fragment_type_;
+    bool fragment_compressed_ = false;
+    std::string fragment_buffer_;
+    Utf8Validator utf8_validator_;
+    ReceiveBuffer recv_buffer_;
+    std::atomic<int64_t> last_pong_ns_{0};
+
+    std::atomic<bool> receiving_;
+    std::thread receive_thread_;
+    ReceiveFlowControl flow_control_;
+    InboundQueue inbound_queue_;
+
+    std::thread send_thread_;
+    SendQueue send_queue_;
+
+    TrafficRecorder recorder_;
+
+    // 大消息的压缩/解压任务在codec_中，放在最后以便析构时最先等待任务结束
+    std::atomic<bool> offload_failed_{false};
+    CompressionPolicy codec_;
+};
+
+// 默认组合：按URL选择TLS，编译时启用zlib则支持压缩，回调在单独的投递线程上调用
+typedef BasicWebSocketClient<AutoTransport, DefaultCompression, ExecutorDispatch> WebSocketClient;
+
+// 连接池参数
+struct ConnectionPoolOptions {
+    size_t min_idle = 2;                  // 每个端点预先建好并保持的空闲连接数
+    size_t max_idle = 8;                  // 归还时空闲连接达到此数则直接关闭
+    int health_check_interval_ms = 5000;  // 空闲连接的ping间隔
+    int pong_timeout_ms = 3000;           // ping后超过此时间未收到pong则丢弃该连接
+    int maintenance_interval_ms = 200;    // 维护线程的检查周期
+};
+
+// 连接池统计
+struct ConnectionPoolStats {
+    uint64_t hits = 0;        // 直接取到空闲连接的次数
+    uint64_t misses = 0;      // 无空闲连接、现场建连的次数
+    uint64_t created = 0;     // 建立的连接总数
+    uint64_t discarded = 0;   // 因断线、健康检查失败或超出max_idle而关闭的连接数
+    size_t idle = 0;          // 当前空闲连接数
+};
+
+// 连接池内部状态，PooledConnection持有其弱引用，连接池销毁后归还的连接直接关闭
+struct ConnectionPoolState {
+    struct IdleConnection {
+        std::shared_ptr<WebSocketClient> client;
+        std::chrono::steady_clock::time_point last_check;
+        std::chrono::steady_clock::time_point ping_sent;
+        bool ping_pending = false;
+    };
+
+    struct Endpoint {
+        WebSocketConfig config;
+        std::vector<IdleConnection> idle;
+        size_t connecting = 0;  // 维护线程正在建立的连接数
+    };
+
+    // 连接归还池中；连接已断开、池已满或已关闭时返回false，由调用者在锁外关闭
+    bool giveBack(const std::string& url, std::shared_ptr<WebSocketClient>& client) {
+        // 清掉借用者设置的回调和未取走的消息
+        client->setOnMsgText(nullptr);
+        client->setOnMsgBinary(nullptr);
+        client->setOnError(nullptr);
+        client->setOnClose(nullptr);
+        if (client->getConfig().getDeliveryMode() == DeliveryMode::QUEUE) {
+            std::vector<Message> batch(64);
+            while (client->receive_batch(batch, 0) > 0) {
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = endpoints.find(url);
+        if (!running || it == endpoints.end() || client->getState() != WebSocketState::OPEN ||
+            it->second.idle.size() >= options.max_idle) {
+            stats.discarded++;
+            return false;
+        }
+
+        IdleConnection idle;
+        idle.client = std::move(client);
+        idle.last_check = std::chrono::steady_clock::now();
+        it->second.idle.push_back(std::move(idle));
+        return true;
+    }
+
+    ConnectionPoolOptions options;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool running = true;
+    std::map<std::string, Endpoint> endpoints;
+    std::vector<std::shared_ptr<WebSocketClient>> closing;  // 待维护线程在锁外关闭的连接
+    ConnectionPoolStats stats;
+};
+
+// 从连接池取出的连接，析构时自动归还，连接已断开时不再放回池中
+class PooledConnection {
+public:
+    PooledConnection() : result_(ResultCode::INVALID_STATE, "Empty connection") {}
+
+    PooledConnection(PooledConnection&& other) noexcept
+        : pool_(std::move(other.pool_)), url_(std::move(other.url_)), client_(std::move(other.client_)), result_(other.result_) {}
+
+    PooledConnection& operator=(PooledConnection&& other) noexcept {
+        if (this != &other) {
+            release();
+            pool_ = std::move(other.pool_);
+            url_ = std::move(other.url_);
+            client_ = std::move(other.client_);
+            result_ = other.result_;
+        }
+        return *this;
+    }
+
+    PooledConnection(const PooledConnection&) = delete;
+    PooledConnection& operator=(const PooledConnection&) = delete;
+
+    ~PooledConnection() { release(); }
+
+    explicit operator bool() const { return client_ != nullptr; }
+    WebSocketClient* operator->() const { return client_.get(); }
+    WebSocketClient& operator*() const { return *client_; }
+    WebSocketClient* get() const { return client_.get(); }
+
+    // 获取失败时的错误
+    const WebSocketResult& result() const { return result_; }
+
+    // 归还连接池
+    void release() {
+        std::shared_ptr<WebSocketClient> client = std::move(client_);
+        std::shared_ptr<ConnectionPoolState> pool = pool_.lock();
+        pool_.reset();
+        if (client && pool) {
+            pool->giveBack(url_, client);
+        }
+        // 未归还的连接在此关闭
+    }
+
+    // 关闭连接，不再归还
+    void discard() {
+        pool_.reset();
+        client_.reset();
+    }
+
+private:
+    friend class ConnectionPool;
+
+    PooledConnection(const std::shared_ptr<ConnectionPoolState>& pool, const std::string& url,
+                     std::shared_ptr<WebSocketClient> client)
+        : pool_(pool), url_(url), client_(std::move(client)), result_(ResultCode::SUCCESS, "") {}
+
+    explicit PooledConnection(const WebSocketResult& result) : result_(result) {}
+
+    std::weak_ptr<ConnectionPoolState> pool_;
+    std::string url_;
+    std::shared_ptr<WebSocketClient> client_;
+    WebSocketResult result_;
+};
+
+// 连接池：按端点保持一定数量已完成握手的空闲连接，acquire时直接交出，
+// 维护线程负责补足空闲连接并用ping检查其健康状态
+class ConnectionPool {
+public:
+    explicit ConnectionPool(const ConnectionPoolOptions& options = ConnectionPoolOptions())
+        : state_(std::make_shared<ConnectionPoolState>()) {
+        state_->options = options;
+        maintenance_thread_ = std::thread([this] { maintenanceLoop(); });
+    }
+
+    ~ConnectionPool() {
+        std::map<std::string, ConnectionPoolState::Endpoint> endpoints;
+        std::vector<std::shared_ptr<WebSocketClient>> closing;
+        {
+            std::lock_guard<std::mutex> lock(state_->mtx);
+            state_->running = false;
+            endpoints.swap(state_->endpoints);
+            closing.swap(state_->closing);
+        }
+        state_->cv.notify_all();
+        if (maintenance_thread_.joinable()) {
+            maintenance_thread_.join();
+        }
+        // 等待进行中的建连结束，建好的连接因running为false直接关闭
+        connects_.clear();
+        // 空闲连接随endpoints在锁外关闭
+    }
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // 注册端点并开始预建连接，config用于该端点的所有连接
+    void addEndpoint(const std::string& url, const WebSocketConfig& config = WebSocketConfig()) {
+        {
+            std::lock_guard<std::mutex> lock(state_->mtx);
+            state_->endpoints[url].config = config;
+        }
+        state_->cv.notify_all();
+    }
+
+    // 取出一个连接，没有空闲连接时现场建连，未注册的端点按默认配置注册
+    PooledConnection acquire(const std::string& url) {
+        WebSocketConfig config;
+        {
+            std::lock_guard<std::mutex> lock(state_->mtx);
+            ConnectionPoolState::Endpoint& endpoint = state_->endpoints[url];
+            while (!endpoint.idle.empty()) {
+                std::shared_ptr<WebSocketClient> client = std::move(endpoint.idle.back().client);
+                endpoint.idle.pop_back();
+                if (client->getState() == WebSocketState::OPEN) {
+                    state_->stats.hits++;
+                    // 唤醒维护线程补足空闲连接
+                    state_->cv.notify_all();
+                    return PooledConnection(state_, url, std::move(client));
+                }
+                state_->stats.discarded++;
+                state_->closing.push_back(std::move(client));
+            }
+            config = endpoint.config;
+            state_->stats.misses++;
+        }
+        state_->cv.notify_all();
+
+        std::shared_ptr<WebSocketClient> client = std::make_shared<WebSocketClient>(config);
+        WebSocketResult res = client->connect_sync(url);
+        if (!res) {
+            return PooledConnection(res);
+        }
+
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        state_->stats.created++;
+        return PooledConnection(state_, url, std::move(client));
+    }
+
+    ConnectionPoolStats stats() const {
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        ConnectionPoolStats stats = state_->stats;
+        stats.idle = 0;
+        for (const auto& endpoint : state_->endpoints) {
+            stats.idle += endpoint.second.idle.size();
+        }
+        return stats;
+    }
+
+private:
+    void maintenanceLoop() {
+        ConnectionPoolState& state = *state_;
+        std::unique_lock<std::mutex> lock(state.mtx);
+        while (state.running) {
+            auto now = std::chrono::steady_clock::now();
+            std::vector<std::shared_ptr<WebSocketClient>> to_ping;
+            std::vector<std::pair<std::string, WebSocketConfig>> to_create;
+
+            for (auto& item : state.endpoints) {
+                ConnectionPoolState::Endpoint& endpoint = item.second;
+                for (auto it = endpoint.idle.begin(); it != endpoint.idle.end();) {
+                    if (!checkHealth(*it, now, to_ping)) {
+                        state.stats.discarded++;
+                        state.closing.push_back(std::move(it->client));
+                        it = endpoint.idle.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+
+                for (size_t n = endpoint.idle.size() + endpoint.connecting; n < state.options.min_idle; ++n) {
+                    endpoint.connecting++;
+                    to_create.push_back(std::make_pair(item.first, endpoint.config));
+                }
+            }
+
+            // 关闭和ping在锁外进行，ping只入队不等待写出
+            std::vector<std::shared_ptr<WebSocketClient>> closing;
+            closing.swap(state.closing);
+            lock.unlock();
+
+            closing.clear();
+            for (auto& client : to_ping) {
+                client->pingAsync();
+            }
+            to_ping.clear();
+
+            // 每个连接单独建连，一个端点DNS或握手卡住不影响其他端点
+            connects_.erase(std::remove_if(connects_.begin(), connects_.end(),
+                                           [](const std::future<void>& f) {
+                                               return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                           }),
+                            connects_.end());
+            for (auto& item : to_create) {
+                std::shared_ptr<ConnectionPoolState> shared = state_;
+                connects_.push_back(std::async(std::launch::async, [shared, item] { createIdle(shared, item.first, item.second); }));
+            }
+
+            lock.lock();
+            if (state.running) {
+                state.cv.wait_for(lock, std::chrono::milliseconds(state.options.maintenance_interval_ms));
+            }
+        }
+    }
+
+    // 建立一个空闲连接放入池中，在单独的线程上运行
+    static void createIdle(const std::shared_ptr<ConnectionPoolState>& shared, const std::string& url,
+                           const WebSocketConfig& config) {
+        ConnectionPoolState& state = *shared;
+        std::shared_ptr<WebSocketClient> client = std::make_shared<WebSocketClient>(config);
+        bool connected = static_cast<bool>(client->connect_sync(url));
+
+        {
+            std::lock_guard<std::mutex> lock(state.mtx);
+            auto it = state.endpoints.find(url);
+            if (it != state.endpoints.end()) {
+                it->second.connecting--;
+                if (connected && state.running) {
+                    state.stats.created++;
+                    ConnectionPoolState::IdleConnection idle;
+                    idle.client = std::move(client);
+                    idle.last_check = std::chrono::steady_clock::now();
+                    it->second.idle.push_back(std::move(idle));
+                }
+            }
+        }
+        // 未放入池中的连接在锁外关闭，建连失败的由维护线程在下个周期重试
+        client.reset();
+    }
+
+    // 返回false表示连接已不可用
+    bool checkHealth(ConnectionPoolState::IdleConnection& idle, std::chrono::steady_clock::time_point now,
+                     std::vector<std::shared_ptr<WebSocketClient>>& to_ping) {
+        if (idle.client->getState() != WebSocketState::OPEN) {
+            return false;
+        }
+
+        const ConnectionPoolOptions& options = state_->options;
+        if (idle.ping_pending) {
+            if (idle.client->getLastPongTime() >= idle.ping_sent) {
+                idle.ping_pending = false;
+                idle.last_check = now;
+            } else if (now - idle.ping_sent > std::chrono::milliseconds(options.pong_timeout_ms)) {
+                return false;
+            }
+        } else if (now - idle.last_check > std::chrono::milliseconds(options.health_check_interval_ms)) {
+            idle.ping_pending = true;
+            idle.ping_sent = now;
+            to_ping.push_back(idle.client);
+        }
+        return true;
+    }
+
+    std::shared_ptr<ConnectionPoolState> state_;
+    std::thread maintenance_thread_;
+    std::vector<std::future<void>> connects_;  // 进行中的建连，只由维护线程和析构函数访问
+};
+
+// 从消息中取出序列号，消息不带序列号(如心跳)时返回false
+typedef std::function<bool(const std::string& message, uint64_t& sequence)> SequenceExtractor;
+
+// 冗余连接统计
+struct RedundantClientStats {
+    uint64_t failovers = 0;           // 备用连接被提升为主连接的次数
+    uint64_t reconnects = 0;          // 重建连接的次数
+    uint64_t duplicates_dropped = 0;  // 按序列号去重丢弃的消息数
+    uint64_t reordered = 0;           // 序列号小于已投递的最大值、但在重排窗口内首次到达而投递的消息数
+};
+
+// 主备冗余连接：同一数据流同时连接两个端点，从主连接投递消息，主连接断开时
+// 立即提升已连好的备用连接，原主连接在后台重连后作为新的备用连接。
+// 设置SequenceExtractor后两条连接的消息都参与投递，按序列号只投递第一次到达的，
+// 切换瞬间也不会丢消息。消息回调串行调用，回调中可以调用send()
+class RedundantClient {
+public:
+    explicit RedundantClient(const WebSocketConfig& config = WebSocketConfig())
+        : config_(config), primary_(0), running_(false), has_sequence_(false), last_sequence_(0),
+          seen_(DEFAULT_REORDER_WINDOW) {}
+
+    ~RedundantClient() {
+        disconnect();
+    }
+
+    RedundantClient(const RedundantClient&) = delete;
+    RedundantClient& operator=(const RedundantClient&) = delete;
+
+    // 设置回调函数，需在connect之前设置
+    void setOnMsgText(std::function<void(const std::string&)> callback) { text_message_callback_ = callback; }
+    void setOnMsgBinary(std::function<void(const std::vector<uint8_t>&)> callback) { binary_message_callback_ = callback; }
+    // 主备切换时调用，参数为新主连接的URL
+    void setOnFailover(std::function<void(const std::string& url)> callback) { failover_callback_ = callback; }
+    // 每条连接建立(包括重连)后调用，用于发送订阅等初始化消息
+    void setOnConnected(std::function<void(WebSocketClient& client, const std::string& url)> callback) { connected_callback_ = callback; }
+    void setSequenceExtractor(SequenceExtractor extractor) { sequence_extractor_ = extractor; }
+    // 重排窗口：比已投递的最大序列号小、但差距在窗口内的消息，首次到达时仍投递，
+    // 用于序列号不严格连续到达(如两路各自乱序)的数据流；更旧的消息按重复丢弃
+    void setReorderWindow(size_t window) { seen_.assign(window > 0 ? window : 1, false); }
+
+    // 连接主备两个端点，同时建连，至少一个成功即返回成功，失败的一端在后台重连
+    WebSocketResult connect(const std::string& primary_url, const std::string& standby_url) {
+        if (running_) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "RedundantClient is already connected");
+        }
+
+        legs_[0].url = primary_url;
+        legs_[1].url = standby_url;
+        primary_ = 0;
+        has_sequence_ = false;
+        running_ = true;
+
+        WebSocketResult results[2] = {
+            WebSocketResult(ResultCode::SUCCESS, ""),
+            WebSocketResult(ResultCode::SUCCESS, "")
+        };
+        std::shared_ptr<WebSocketClient> clients[2];
+        std::future<WebSocketResult> standby = std::async(std::launch::async, [this, &clients] {
+            return openLeg(1, clients[1]);
+        });
+        results[0] = openLeg(0, clients[0]);
+        results[1] = standby.get();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (int i = 0; i < 2; ++i) {
+                legs_[i].client = clients[i];
+                legs_[i].retry_at = std::chrono::steady_clock::now();
+            }
+        }
+
+        if (!results[0] && !results[1]) {
+            running_ = false;
+            legs_[0].client.reset();
+            legs_[1].client.reset();
+            return results[0];
+        }
+        if (!results[0]) {
+            promote(1);
+        }
+
+        supervisor_ = std::thread([this] { superviseLoop(); });
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+    void disconnect() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!running_) return;
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (supervisor_.joinable()) {
+            supervisor_.join();
+        }
+
+        std::shared_ptr<WebSocketClient> clients[2];
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            clients[0].swap(legs_[0].client);
+            clients[1].swap(legs_[1].client);
+        }
+        for (auto& client : clients) {
+            if (client) {
+                client->disconnect();
+            }
+        }
+    }
+
+    // 通过当前主连接发送
+    WebSocketResult send(const std::string& message, SendPriority priority = SendPriority::NORMAL) {
+        std::shared_ptr<WebSocketClient> client = primaryClient();
+        if (!client) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "No open connection");
+        }
+        return client->send(message, priority);
+    }
+
+    WebSocketResult sendBinary(const std::string& data, SendPriority priority = SendPriority::NORMAL) {
+        std::shared_ptr<WebSocketClient> client = primaryClient();
+        if (!client) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "No open connection");
+        }
+        return client->sendBinary(data, priority);
+    }
+
+    // 当前主连接的URL
+    std::string getPrimaryUrl() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return legs_[primary_.load()].url;
+    }
+
+    RedundantClientStats getStats() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        RedundantClientStats stats = stats_;
+        stats.duplicates_dropped = duplicates_dropped_.load();
+        stats.reordered = reordered_.load();
+        return stats;
+    }
+
+private:
+    struct Leg {
+        std::string url;
+        std::shared_ptr<WebSocketClient> client;
+        std::chrono::steady_clock::time_point retry_at;  // 断开后下次重连的时间
+    };
+
+    WebSocketResult openLeg(int index, std::shared_ptr<WebSocketClient>& client) {
+        client = std::make_shared<WebSocketClient>(config_);
+        client->setOnMsgText([this, index](const std::string& message) {
+            onLegMessage(index, FrameType::TEXT, message);
+        });
+        client->setOnMsgBinary([this, index](const std::vector<uint8_t>& data) {
+            onLegMessage(index, FrameType::BINARY, std::string(data.begin(), data.end()));
+        });
+        client->setOnClose([this](const std::string&) {
+            cv_.notify_all();
+        });
+
+        WebSocketResult result = client->connect_sync(legs_[index].url);
+        if (!result) {
+            client.reset();
+            return result;
+        }
+        if (connected_callback_) {
+            connected_callback_(*client, legs_[index].url);
+        }
+        return result;
+    }
+
+    std::shared_ptr<WebSocketClient> primaryClient() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        const std::shared_ptr<WebSocketClient>& client = legs_[primary_.load()].client;
+        if (client && client->getState() == WebSocketState::OPEN) {
+            return client;
+        }
+        return nullptr;
+    }
+
+    // 两条连接的回调线程都会进入，deliver_mtx_保证序列号判断和投递的原子性
+    void onLegMessage(int index, FrameType type, const std::string& payload) {
+        std::lock_guard<std::mutex> lock(deliver_mtx_);
+        if (!running_) return;
+
+        uint64_t sequence = 0;
+        if (sequence_extractor_ && sequence_extractor_(payload, sequence)) {
+            if (!acceptSequence(sequence)) {
+                duplicates_dropped_++;
+                return;
+            }
+        } else if (index != primary_) {
+            // 无法去重的消息只取主连接的
+            return;
+        }
+
+        if (type == FrameType::TEXT) {
+            if (text_message_callback_) {
+                text_message_callback_(payload);
+            }
+        } else if (binary_message_callback_) {
+            binary_message_callback_(std::vector<uint8_t>(payload.begin(), payload.end()));
+        }
+    }
+
+    // 记录序列号，已投递过或落在重排窗口之外时返回false；调用者持有deliver_mtx_
+    bool acceptSequence(uint64_t sequence) {
+        size_t window = seen_.size();
+        if (!has_sequence_ || sequence > last_sequence_) {
+            // 窗口前移，清掉移出窗口的位置
+            uint64_t advance = has_sequence_ ? sequence - last_sequence_ : window;
+            if (advance >= window) {
+                std::fill(seen_.begin(), seen_.end(), false);
+            } else {
+                for (uint64_t s = last_sequence_ + 1; s < sequence; ++s) {
+                    seen_[s % window] = false;
+                }
+            }
+            seen_[sequence % window] = true;
+            has_sequence_ = true;
+            last_sequence_ = sequence;
+            return true;
+        }
+
+        if (last_sequence_ - sequence >= window || seen_[sequence % window]) {
+            return false;
+        }
+        seen_[sequence % window] = true;
+        reordered_++;
+        return true;
+    }
+
+    void promote(int index) {
+        std::string url;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (primary_ == index) return;
+            primary_ = index;
+            stats_.failovers++;
+            url = legs_[index].url;
+        }
+        if (failover_callback_) {
+            failover_callback_(url);
+        }
+    }
+
+    // 监视两条连接：主连接断开时提升备用连接，断开的连接按重连间隔在后台重建
+    void superviseLoop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (running_) {
+            auto now = std::chrono::steady_clock::now();
+            bool alive[2];
+            for (int i = 0; i < 2; ++i) {
+                alive[i] = legs_[i].client && legs_[i].client->getState() == WebSocketState::OPEN;
+            }
+
+            int primary = primary_;
+            if (!alive[primary] && alive[1 - primary]) {
+                lock.unlock();
+                promote(1 - primary);
+                lock.lock();
+                continue;
+            }
+
+            for (int i = 0; i < 2 && running_; ++i) {
+                if (alive[i] || now < legs_[i].retry_at) continue;
+
+                // 在锁外关闭旧连接并重连
+                std::shared_ptr<WebSocketClient> old;
+                old.swap(legs_[i].client);
+                lock.unlock();
+                old.reset();
+                std::shared_ptr<WebSocketClient> client;
+                bool connected = static_cast<bool>(openLeg(i, client));
+                lock.lock();
+
+                legs_[i].client = client;
+                legs_[i].retry_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.getReconnectDelay());
+                if (connected) {
+                    stats_.reconnects++;
+                }
+            }
+
+            cv_.wait_for(lock, std::chrono::milliseconds(50));
+        }
+    }
+
+    WebSocketConfig config_;
+    Leg legs_[2];
+    std::atomic<int> primary_;
+    std::atomic<bool> running_;
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::thread supervisor_;
+    RedundantClientStats stats_;
+
+    std::mutex deliver_mtx_;
+    SequenceExtractor sequence_extractor_;
+    bool has_sequence_;
+    uint64_t last_sequence_;  // 已投递的最大序列号
+    static const size_t DEFAULT_REORDER_WINDOW = 1024;
+    std::vector<bool> seen_;  // 最近seen_.size()个序列号是否已投递，按序列号取模存放
+    std::atomic<uint64_t> duplicates_dropped_{0};
+    std::atomic<uint64_t> reordered_{0};
+
+    std::function<void(const std::string&)> text_message_callback_;
+    std::function<void(const std::vector<uint8_t>&)> binary_message_callback_;
+    std::function<void(const std::string&)> failover_callback_;
+    std::function<void(WebSocketClient&, const std::string&)> connected_callback_;
+};
+
+// A/B行情仲裁参数
+struct FeedArbitratorOptions {
+    int gap_timeout_ms = 0;      // 发现序列号缺口后等待另一路补齐的时间，0表示立即报告缺口并继续投递
+    size_t max_pending = 65536;  // 等待补齐期间缓存的乱序消息上限，超过则立即报告缺口
+};
+
+// A/B行情仲裁统计
+struct FeedArbitratorStats {
+    uint64_t delivered = 0;        // 投递的消息数
+    uint64_t duplicates = 0;       // 另一路已投递而丢弃的消息数
+    uint64_t first_arrivals[2] = {0, 0};  // 各路先到并被投递的消息数，反映哪一路更快
+    uint64_t gaps = 0;             // 报告的缺口数
+    uint64_t missing = 0;          // 缺口中丢失的消息总数
+    uint64_t reconnects = 0;       // 重建连接的次数
+};
+
+// A/B行情仲裁：同一数据流的两路连接同时接收，按序列号只投递先到的一份，
+// 按序到达的消息直接从收到它的连接投递，不做拷贝；序列号跳跃时缓存后续消息等待另一路补齐，
+// 超时仍缺失则报告缺口。两路各自断线重连，互不影响
+class FeedArbitrator {
+public:
+    explicit FeedArbitrator(SequenceExtractor extractor,
+                            const FeedArbitratorOptions& options = FeedArbitratorOptions(),
+                            const WebSocketConfig& config = WebSocketConfig())
+        : extractor_(extractor), options_(options), config_(config), running_(false),
+          started_(false), next_sequence_(0) {}
+
+    ~FeedArbitrator() {
+        disconnect();
+    }
+
+    FeedArbitrator(const FeedArbitrator&) = delete;
+    FeedArbitrator& operator=(const FeedArbitrator&) = delete;
+
+    // 设置回调函数，需在connect之前设置，feed为0(A路)或1(B路)。
+    // 消息和缺口回调在仲裁锁内调用以保证按序列号顺序，回调中不能调用getStats和onFeedMessage，否则死锁
+    void setOnMessage(std::function<void(const std::string& message, uint64_t sequence, int feed)> callback) { message_callback_ = callback; }
+    // 报告缺口[first, last]
+    void setOnGap(std::function<void(uint64_t first, uint64_t last)> callback) { gap_callback_ = callback; }
+    // 每路连接建立(包括重连)后调用，用于发送订阅
+    void setOnConnected(std::function<void(WebSocketClient& client, const std::string& url)> callback) { connected_callback_ = callback; }
+
+    // 连接A、B两路，至少一路成功即返回成功，失败的一路在后台重连
+    WebSocketResult connect(const std::string& url_a, const std::string& url_b) {
+        if (running_) {
+            return WebSocketResult(ResultCode::INVALID_STATE, "FeedArbitrator is already connected");
+        }
+
+        // 重新连接时服务端可能已重置序列号，仲裁从新连接的第一条消息开始
+        {
+            std::lock_guard<std::mutex> lock(arbiter_mtx_);
+            started_ = false;
+            next_sequence_ = 0;
+            pending_.clear();
+            stats_ = FeedArbitratorStats();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            reconnects_ = 0;
+        }
+
+        legs_[0].url = url_a;
+        legs_[1].url = url_b;
+        running_ = true;
+
+        // 两路同时建连，一路卡住不推迟另一路
+        WebSocketResult results[2] = {
+            WebSocketResult(ResultCode::SUCCESS, ""),
+            WebSocketResult(ResultCode::SUCCESS, "")
+        };
+        std::shared_ptr<WebSocketClient> clients[2];
+        std::future<WebSocketResult> feed_b = std::async(std::launch::async, [this, &clients] {
+            return openLeg(1, clients[1]);
+        });
+        results[0] = openLeg(0, clients[0]);
+        results[1] = feed_b.get();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            for (int i = 0; i < 2; ++i) {
+                legs_[i].client = clients[i];
+                legs_[i].retry_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.getReconnectDelay());
+            }
+        }
+
+        if (!results[0] && !results[1]) {
+            running_ = false;
+            legs_[0].client.reset();
+            legs_[1].client.reset();
+            return results[0];
+        }
+
+        supervisor_ = std::thread([this] { superviseLoop(); });
+        return WebSocketResult(ResultCode::SUCCESS, "");
+    }
+
+    void disconnect() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!running_) return;
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (supervisor_.joinable()) {
+            supervisor_.join();
+        }
+
+        std::shared_ptr<WebSocketClient> clients[2];
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            clients[0].swap(legs_[0].client);
+            clients[1].swap(legs_[1].client);
+        }
+        for (auto& client : clients) {
+            if (client) {
+                client->disconnect();
+            }
+        }
+    }
+
+    // 直接送入一条消息，通常由内部连接调用，也可用于接入其他来源或测试
+    void onFeedMessage(int feed, const std::string& message) {
+        std::unique_lock<std::mutex> lock(arbiter_mtx_);
+
+        uint64_t sequence = 0;
+        if (!extractor_ || !extractor_(message, sequence)) {
+            // 没有序列号的消息(如心跳)只取A路
+            if (feed == 0 && message_callback_) {
+                message_callback_(message, 0, feed);
+            }
+            return;
+        }
+
+        if (!started_) {
+            started_ = true;
+            next_sequence_ = sequence;
+        }
+
+        // 监视线程之外也在消息到达时检查缺口是否已超时
+        if (!pending_.empty() && std::chrono::steady_clock::now() >= gap_deadline_) {
+            reportGap(pending_.begin()->first);
+            drainPending();
+        }
+
+        if (sequence < next_sequence_ || pending_.count(sequence)) {
+            stats_.duplicates++;
+            return;
+        }
+
+        if (sequence == next_sequence_) {
+            deliver(message, sequence, feed);
+            drainPending();
+            return;
+        }
+
+        // 序列号跳跃
+        if (options_.gap_timeout_ms <= 0) {
+            reportGap(sequence);
+            deliver(message, sequence, feed);
+            return;
+        }
+
+        bool new_gap = pending_.empty();
+        if (new_gap) {
+            gap_deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.gap_timeout_ms);
+            gap_epoch_++;
+        }
+        pending_.insert(std::make_pair(sequence, Pending{message, feed}));
+        if (pending_.size() > options_.max_pending) {
+            reportGap(pending_.begin()->first);
+            drainPending();
+        }
+        lock.unlock();
+
+        // 唤醒监视线程按新的缺口截止时间等待
+        if (new_gap) {
+            { std::lock_guard<std::mutex> guard(mtx_); }
+            cv_.notify_all();
+        }
     }
 
-    void stop() noexcept {
+    FeedArbitratorStats getStats() const {
+        FeedArbitratorStats stats;
         {
-            std::unique_lock<std::mutex> lock(mtx_);
-            if (!run_) {
-                return;
-            }
+            std::lock_guard<std::mutex> lock(arbiter_mtx_);
+            stats = stats_;
+        }
+        std::lock_guard<std::mutex> lock(mtx_);
+        stats.reconnects = reconnects_;
+        return stats;
+    }
 
-            run_ = false;
+private:
+    struct Leg {
+        std::string url;
+        std::shared_ptr<WebSocketClient> client;
+        std::chrono::steady_clock::time_point retry_at;
+    };
+
+    struct Pending {
+        std::string message;
+        int feed;
+    };
+
+    WebSocketResult openLeg(int index, std::shared_ptr<WebSocketClient>& client) {
+        client = std::make_shared<WebSocketClient>(config_);
+        client->setOnMsgText([this, index](const std::string& message) {
+            onFeedMessage(index, message);
+        });
+        client->setOnClose([this](const std::string&) {
+            cv_.notify_all();
+        });
+
+        WebSocketResult result = client->connect_sync(legs_[index].url);
+        if (!result) {
+            client.reset();
+            return result;
         }
+        if (connected_callback_) {
+            connected_callback_(*client, legs_[index].url);
+        }
+        return result;
+    }
 
-        cv_.notify_all();
-        worker_.join();
+    // 以下在arbiter_mtx_内调用
+    void deliver(const std::string& message, uint64_t sequence, int feed) {
+        next_sequence_ = sequence + 1;
+        stats_.delivered++;
+        stats_.first_arrivals[feed]++;
+        if (message_callback_) {
+            message_callback_(message, sequence, feed);
+        }
     }
 
-    void push_task(std::function<void()> task) {
-        {
-            std::unique_lock<std::mutex> lock(mtx_);
-            tasks_.push(std::move(task));
+    // 投递缓存中已连续的消息，仍有缺口时重新计时
+    void drainPending() {
+        while (!pending_.empty() && pending_.begin()->first == next_sequence_) {
+            auto it = pending_.begin();
+            deliver(it->second.message, it->first, it->second.feed);
+            pending_.erase(it);
+        }
+        if (!pending_.empty()) {
+            gap_deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.gap_timeout_ms);
         }
-        cv_.notify_one();
     }
 
-    void clear() {
-        {
-            std::unique_lock<std::mutex> lock(mtx_);
-            tasks_.clear();
+    // 放弃[next_sequence_, sequence)，从sequence继续
+    void reportGap(uint64_t sequence) {
+        uint64_t first = next_sequence_;
+        stats_.gaps++;
+        stats_.missing += sequence - first;
+        next_sequence_ = sequence;
+        if (gap_callback_) {
+            gap_callback_(first, sequence - 1);
         }
-        cv_.notify_all();
     }
 
-private:
-    void run() {
-        while (true) {
-            std::function<void()> task;
-            {
-                std::unique_lock<std::mutex> lock(mtx_);
-                cv_.wait(lock, [this] { return !run_ || !tasks_.empty(); });
+    // 缺口等待超时
+    void checkGapTimeout(std::chrono::steady_clock::time_point now) {
+        std::lock_guard<std::mutex> lock(arbiter_mtx_);
+        if (!pending_.empty() && now >= gap_deadline_) {
+            reportGap(pending_.begin()->first);
+            drainPending();
+        }
+    }
 
-                if (!run_ && tasks_.empty()) {
-                    return;
-                }
+    std::chrono::steady_clock::time_point nextGapDeadline() const {
+        std::lock_guard<std::mutex> lock(arbiter_mtx_);
+        return pending_.empty() ? std::chrono::steady_clock::time_point::max() : gap_deadline_;
+    }
 
-                task = std::move(tasks_.front());
-                tasks_.pop();
+    // 检查缺口超时，断开的一路按重连间隔在后台重建；mtx_与arbiter_mtx_不同时持有
+    void superviseLoop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (running_) {
+            auto now = std::chrono::steady_clock::now();
+            lock.unlock();
+            checkGapTimeout(now);
+            lock.lock();
+
+            for (int i = 0; i < 2 && running_; ++i) {
+                bool alive = legs_[i].client && legs_[i].client->getState() == WebSocketState::OPEN;
+                if (alive || now < legs_[i].retry_at) continue;
+
+                std::shared_ptr<WebSocketClient> old;
+                old.swap(legs_[i].client);
+                lock.unlock();
+                old.reset();
+                std::shared_ptr<WebSocketClient> client;
+                bool connected = static_cast<bool>(openLeg(i, client));
+                lock.lock();
+
+                legs_[i].client = client;
+                legs_[i].retry_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.getReconnectDelay());
+                if (connected) {
+                    reconnects_++;
+                }
             }
-            task();
+
+            uint64_t epoch = gap_epoch_;
+            lock.unlock();
+            auto wake = std::min(nextGapDeadline(), std::chrono::steady_clock::now() + std::chrono::milliseconds(50));
+            lock.lock();
+            cv_.wait_until(lock, wake, [this, epoch] { return !running_ || gap_epoch_ != epoch; });
         }
     }
 
-    std::thread worker_;
-    std::mutex mtx_;
+    SequenceExtractor extractor_;
+    FeedArbitratorOptions options_;
+    WebSocketConfig config_;
+
+    Leg legs_[2];
+    std::atomic<bool> running_;
+    mutable std::mutex mtx_;
     std::condition_variable cv_;
-    std::queue<std::function<void()>> tasks_;
-    bool run_;
+    std::thread supervisor_;
+    uint64_t reconnects_ = 0;
+
+    mutable std::mutex arbiter_mtx_;
+    bool started_;
+    uint64_t next_sequence_;
+    std::map<uint64_t, Pending> pending_;
+    std::chrono::steady_clock::time_point gap_deadline_;
+    std::atomic<uint64_t> gap_epoch_{0};  // 每出现新缺口加一
+    FeedArbitratorStats stats_;
+
+    std::function<void(const std::string&, uint64_t, int)> message_callback_;
+    std::function<void(uint64_t, uint64_t)> gap_callback_;
+    std::function<void(WebSocketClient&, const std::string&)> connected_callback_;
 };
 
+// 分片订阅参数
+struct SubscriptionManagerOptions {
+    size_t max_topics_per_connection = 200;  // 单连接订阅上限，通常由服务端规定
+    size_t max_connections = 64;             // 最多建立的连接数
+    size_t subscribe_batch_size = 50;        // 每条订阅消息包含的主题数
+};
 
-// WebSocket客户端主类
-class WebSocketClient {
-public:
-    WebSocketClient() : state_(WebSocketState::CLOSED), config_(WebSocketConfig()) {
-    }
+// 分片订阅统计
+struct SubscriptionManagerStats {
+    size_t topics = 0;              // 已订阅的主题数
+    size_t unassigned = 0;          // 因连接数达到上限或连接全部断开而暂未订阅的主题数
+    size_t connections = 0;         // 连接数
+    size_t open_connections = 0;    // 正常的连接数
+    uint64_t rebalanced = 0;        // 连接断开后迁移到其他连接的主题数
+    uint64_t reconnects = 0;        // 重建连接的次数
+};
 
-    explicit WebSocketClient(const WebSocketConfig& config) : state_(WebSocketState::CLOSED), config_(config) {
+// 由一批主题生成订阅或退订消息
+typedef std::function<std::string(const std::vector<std::string>& topics)> SubscribeMessageBuilder;
+
+// 分片订阅管理：把大量主题按单连接上限分散到多条连接，优先放入订阅数最少的连接；
+// 连接断开时把它的主题迁移到其他有余量的连接，断开的连接在后台重连后再订阅剩下的主题。
+// 所有连接收到的消息合并到同一个投递线程，按到达顺序串行回调
+class SubscriptionManager {
+public:
+    SubscriptionManager(const std::string& url, SubscribeMessageBuilder subscribe_builder,
+                        SubscribeMessageBuilder unsubscribe_builder = nullptr,
+                        const SubscriptionManagerOptions& options = SubscriptionManagerOptions(),
+                        const WebSocketConfig& config = WebSocketConfig())
+        : url_(url), subscribe_builder_(subscribe_builder), unsubscribe_builder_(unsubscribe_builder),
+          options_(options), config_(config), running_(true) {
+        if (options_.max_topics_per_connection == 0) options_.max_topics_per_connection = 1;
+        if (options_.subscribe_batch_size == 0) options_.subscribe_batch_size = 1;
+        dispatcher_.start();
+        supervisor_ = std::thread([this] { superviseLoop(); });
     }
 
-    ~WebSocketClient() {
+    ~SubscriptionManager() {
         disconnect();
     }
 
-    // 设置回调函数
-    void setOnMsgText(std::function<void(const std::string&)> callback) { text_message_callback_ = callback; }
-    void setOnMsgBinary(std::function<void(const std::vector<uint8_t>&)> callback) { binary_message_callback_ = callback; }
-    void setOnError(std::function<void(const std::string& reason)> callback) { error_callback_ = callback; }
-    void setOnOpen(std::function<void()> callback) { open_callback_ = callback; }
-    void setOnClose(std::function<void(const std::string& reason)> callback) { close_callback_ = callback; }
+    SubscriptionManager(const SubscriptionManager&) = delete;
+    SubscriptionManager& operator=(const SubscriptionManager&) = delete;
 
+    // 消息回调，在投递线程上调用，shard为收到消息的连接编号
+    void setOnMessage(std::function<void(const std::string& message, size_t shard)> callback) { message_callback_ = callback; }
 
+    // 订阅主题，按需建立新连接；连接数达到上限时放不下的主题暂不订阅，返回BUFFER_OVERFLOW，
+    // 之后有连接腾出余量时自动订阅
+    WebSocketResult subscribe(const std::vector<std::string>& topics) {
+        Batches batches;
+        size_t new_shards = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!running_) {
+                return WebSocketResult(ResultCode::INVALID_STATE, "SubscriptionManager is closed");
+            }
+            for (const auto& topic : topics) {
+                if (!assignment_.count(topic) && !unassigned_.count(topic)) {
+                    unassigned_.insert(topic);
+                }
+            }
+            assignUnassigned(batches);
 
-    // 连接方法
-    WebSocketResult connect_sync(const std::string& url) noexcept {
-        WebSocketState state = WebSocketState::CLOSED;
-        if (_state.compare_exchange_strong(state, WebSocketState::CONNECTING)) {
-            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is already connecting");
+            // 现有连接放不下的，计算需要新建的连接数
+            size_t limit = options_.max_topics_per_connection;
+            new_shards = (unassigned_.size() + limit - 1) / limit;
+            if (shards_.size() + new_shards > options_.max_connections) {
+                new_shards = options_.max_connections > shards_.size() ? options_.max_connections - shards_.size() : 0;
+            }
         }
 
-        URL u;
-        if (auto res = u.parse(url); !res) {
-            _state = WebSocketState::CLOSED;
-            return res;
+        // 建连可能阻塞，在锁外进行
+        WebSocketResult result(ResultCode::SUCCESS, "");
+        for (size_t i = 0; i < new_shards; ++i) {
+            WebSocketResult res = addShard();
+            if (!res) {
+                result = res;
+                break;
+            }
         }
 
-        // 连接网络
-        if (auto res = connection_.connect(url.host(), url.port(), (url.scheme() == "wss")); !res) {
-            _state = WebSocketState::CLOSED;
-            return res;
+        size_t pending = 0;
+        {
+            // 新连接都建好后再分配，使各连接负载均衡
+            std::lock_guard<std::mutex> lock(mtx_);
+            assignUnassigned(batches);
+            pending = unassigned_.size();
         }
+        sendBatches(batches, true);
 
-        // 执行握手
-        if (auto res = performHandshake(url); !res) {
-            connection_.close();
-
-            _state = WebSocketState::CLOSED;
-            return res;
+        if (result && pending > 0) {
+            result = WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Connection limit reached, " +
+                                     std::to_string(pending) + " topics pending");
         }
-
-        // 启动工作线程
-        startWorker();
-
-        _state = WebSocketState::OPEN;
-        onOpen();
-
-        return WebSocketResult(ResultCode::SUCCESS, "");
+        return result;
     }
 
-    void connect_async(const std::string& url, const std::function<void(WebSocketResult)>& callback) noexcept {
-        task_runner_.start();
-        task_runner_.push_task([this, url, callback] {
-             callback(connect_sync(url));
-        });
+    void unsubscribe(const std::vector<std::string>& topics) {
+        Batches unsubscribes;
+        Batches subscribes;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            std::map<size_t, std::vector<std::string>> by_shard;
+            for (const auto& topic : topics) {
+                unassigned_.erase(topic);
+                auto it = assignment_.find(topic);
+                if (it == assignment_.end()) continue;
+                shards_[it->second]->topics.erase(topic);
+                by_shard[it->second].push_back(topic);
+                assignment_.erase(it);
+            }
+            for (auto& item : by_shard) {
+                Shard& shard = *shards_[item.first];
+                if (shard.open) {
+                    unsubscribes.push_back(std::make_pair(shard.client, std::move(item.second)));
+                }
+            }
+            // 腾出的余量留给等待中的主题
+            assignUnassigned(subscribes);
+        }
+        sendBatches(unsubscribes, false);
+        sendBatches(subscribes, true);
     }
 
-    // 断开连接
     void disconnect() {
-        if (state_ == WebSocketState::OPEN) {
-            setState(WebSocketState::CLOSING);
-            
-            // 发送关闭帧
-            sendCloseFrame();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!running_) return;
+            running_ = false;
         }
-
-        // 停止工作线程
-        stopWorker();
-
-        setState(WebSocketState::CLOSED);
-        
-        // 关闭网络连接
-        connection_.close();
-    }
-
-    // 发送消息
-    WebSocketResult send(const std::string& message) {
-        if (state_ != WebSocketState::OPEN) {
-            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+        cv_.notify_all();
+        if (supervisor_.joinable()) {
+            supervisor_.join();
         }
 
-        return sendFrame(FrameType::TEXT, message);
-    }
-
-    WebSocketResult sendBinary(const std::string& data) {
-        if (state_ != WebSocketState::OPEN) {
-            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+        std::vector<std::unique_ptr<Shard>> shards;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            shards.swap(shards_);
+            assignment_.clear();
+            unassigned_.clear();
         }
-
-        return sendFrame(FrameType::BINARY, data);
+        for (auto& shard : shards) {
+            if (shard->client) {
+                shard->client->disconnect();
+            }
+        }
+        dispatcher_.stop();
     }
 
-    // 发送ping
-    WebSocketResult ping(const std::string& data = "") {
-        if (state_ != WebSocketState::OPEN) {
-            return WebSocketResult(ResultCode::INVALID_STATE, "WebSocket is not open");
+    SubscriptionManagerStats getStats() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        SubscriptionManagerStats stats = stats_;
+        stats.topics = assignment_.size();
+        stats.unassigned = unassigned_.size();
+        stats.connections = shards_.size();
+        for (const auto& shard : shards_) {
+            if (shard->open) stats.open_connections++;
         }
-
-        return sendFrame(FrameType::PING, data);
+        return stats;
     }
 
-    // 获取状态
-    WebSocketState getState() const { return state_; }
-    const WebSocketConfig& getConfig() const { return config_; }
-
-    // 更新配置
-    void updateConfig(const WebSocketConfig& config) {
-        config_ = config;
+    // 各连接当前订阅的主题数
+    std::vector<size_t> getShardLoads() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<size_t> loads;
+        for (const auto& shard : shards_) {
+            loads.push_back(shard->topics.size());
+        }
+        return loads;
     }
 
 private:
+    typedef std::vector<std::pair<std::shared_ptr<WebSocketClient>, std::vector<std::string>>> Batches;
+
+    struct Shard {
+        std::shared_ptr<WebSocketClient> client;
+        std::set<std::string> topics;
+        bool open = false;
+        std::chrono::steady_clock::time_point retry_at;
+    };
+
+    WebSocketResult openClient(size_t index, std::shared_ptr<WebSocketClient>& client) {
+        client = std::make_shared<WebSocketClient>(config_);
+        client->setOnMsgText([this, index](const std::string& message) {
+            dispatcher_.push_task([this, index, message] {
+                if (message_callback_) {
+                    message_callback_(message, index);
+                }
+            });
+        });
+        client->setOnClose([this](const std::string&) {
+            cv_.notify_all();
+        });
 
-    WebSocketResult performHandshake(const URL& url) noexcept {
-        // 发送握手请求
-        std::string accept_key;
-        std::string request = WebSocketHandshake::createHandshakeRequest(url, config_, accept_key);
-        if (auto res = connection_.send(request); !res) {
-            return res;
+        WebSocketResult result = client->connect_sync(url_);
+        if (!result) {
+            client.reset();
         }
+        return result;
+    }
 
-        // 接收握手响应
-        std::string response;
-        char buffer[1024];
-        int bytes_received;
-        
-        while ((bytes_received = connection_.receive(buffer, sizeof(buffer))) > 0) {
-            response.append(buffer, bytes_received);
-            if (response.find("\r\n\r\n") != std::string::npos) {
-                break;
+    // 新建一条连接
+    WebSocketResult addShard() {
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!running_ || shards_.size() >= options_.max_connections) {
+                return WebSocketResult(ResultCode::BUFFER_OVERFLOW, "Connection limit reached");
             }
+            // 先占位，保证编号稳定；建连完成前监视线程不会重连它
+            index = shards_.size();
+            shards_.push_back(std::unique_ptr<Shard>(new Shard()));
+            shards_.back()->retry_at = std::chrono::steady_clock::time_point::max();
         }
 
-        if (response.empty()) {
-            return WebSocketResult(ResultCode::HANDSHAKE_ERROR, "Empty handshake response");
-        }
-
-        // 解析响应
-        return WebSocketHandshake::parseHandshakeResponse(response, accept_key);
-    }
-
-    void startWorker() {
-        _runner.start();
-
-        //do for recv
-        //... 
-
-        //do for ping
-        //...
-
-    }
+        std::shared_ptr<WebSocketClient> client;
+        WebSocketResult result = openClient(index, client);
 
-    void stopWorker() {
-        _runner.stop();
+        std::lock_guard<std::mutex> lock(mtx_);
+        Shard& shard = *shards_[index];
+        shard.retry_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.getReconnectDelay());
+        if (result) {
+            shard.client = client;
+            shard.open = true;
+        }
+        return result;
     }
 
-    bool receiveFrame() {
-        char buffer[1024];
-        std::string frame_data;
-        
-        // 接收帧头（至少2字节）
-        int bytes_received = connection_.receive(buffer, 2);
-        if (bytes_received <= 0) return false;
-        
-        frame_data.append(buffer, bytes_received);
-        
-        // 解析帧头以获取载荷长度
-        if (frame_data.length() < 2) return false;
-        
-        uint8_t second_byte = static_cast<uint8_t>(frame_data[1]);
-        uint64_t payload_length = second_byte & 0x7F;
-        size_t header_length = 2;
-        
-        if (payload_length == 126) {
-            header_length = 4;
-        } else if (payload_length == 127) {
-            header_length = 10;
-        }
-        
-        // 接收完整的帧头
-        while (frame_data.length() < header_length) {
-            bytes_received = connection_.receive(buffer, header_length - frame_data.length());
-            if (bytes_received <= 0) return false;
-            frame_data.append(buffer, bytes_received);
-        }
-        
-        // 解析掩码密钥
-        bool masked = (second_byte & 0x80) != 0;
-        if (masked) {
-            header_length += 4;
-            while (frame_data.length() < header_length) {
-                bytes_received = connection_.receive(buffer, header_length - frame_data.length());
-                if (bytes_received <= 0) return false;
-                frame_data.append(buffer, bytes_received);
+    // 把等待中的主题放入订阅数最少且有余量的连接，调用时持有mtx_
+    void assignUnassigned(Batches& batches) {
+        std::map<size_t, std::vector<std::string>> by_shard;
+        for (auto it = unassigned_.begin(); it != unassigned_.end();) {
+            Shard* target = nullptr;
+            size_t target_index = 0;
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                Shard& shard = *shards_[i];
+                if (!shard.open || shard.topics.size() >= options_.max_topics_per_connection) continue;
+                if (!target || shard.topics.size() < target->topics.size()) {
+                    target = &shard;
+                    target_index = i;
+                }
             }
+            if (!target) break;
+
+            target->topics.insert(*it);
+            assignment_[*it] = target_index;
+            by_shard[target_index].push_back(*it);
+            it = unassigned_.erase(it);
         }
-        
-        // 接收载荷数据
-        while (frame_data.length() < header_length + payload_length) {
-            size_t remaining = header_length + payload_length - frame_data.length();
-            bytes_received = connection_.receive(buffer, std::min(remaining, sizeof(buffer)));
-            if (bytes_received <= 0) return false;
-            frame_data.append(buffer, bytes_received);
+        for (auto& item : by_shard) {
+            batches.push_back(std::make_pair(shards_[item.first]->client, std::move(item.second)));
         }
-        
-        // 解析帧
-        WebSocketFrame frame = WebSocketFrame::parse(frame_data);
-        handleFrame(frame);
-        
-        return true;
     }
 
-    void handleFrame(const WebSocketFrame& frame) {
-        switch (static_cast<FrameType>(frame.getOpcode())) {
-            case FrameType::TEXT:
-            case FrameType::BINARY: {
-                std::string payload = frame.getPayload();
-                
-                #ifdef USE_ZLIB
-                if (config_.isCompressionEnabled() && !payload.empty()) {
-                    payload = compression_.decompress(payload);
+    // 按批发送订阅(subscribe为true)或退订消息；订阅发送失败的主题退回等待队列，由监视线程重新分配
+    void sendBatches(const Batches& batches, bool subscribe) {
+        const SubscribeMessageBuilder& builder = subscribe ? subscribe_builder_ : unsubscribe_builder_;
+        if (!builder) return;
+        bool requeued = false;
+        for (const auto& batch : batches) {
+            const std::vector<std::string>& topics = batch.second;
+            for (size_t i = 0; i < topics.size(); i += options_.subscribe_batch_size) {
+                size_t end = std::min(topics.size(), i + options_.subscribe_batch_size);
+                std::vector<std::string> chunk(topics.begin() + i, topics.begin() + end);
+                if (!batch.first->send(builder(chunk)) && subscribe) {
+                    requeue(batch.first, chunk);
+                    requeued = true;
                 }
-                #endif
-                
-                message_callback_(payload);
-                break;
-            }
-            case FrameType::CLOSE: {
-                setState(WebSocketState::CLOSING);
-                sendCloseFrame();
-                setState(WebSocketState::CLOSED);
-                break;
-            }
-            case FrameType::PING: {
-                sendFrame(FrameType::PONG, frame.getPayload());
-                break;
-            }
-            case FrameType::PONG: {
-                // 处理pong响应
-                break;
             }
-            default:
-                break;
         }
-    }
-
-    bool sendFrame(FrameType type, const std::string& payload) {
-        std::string data_to_send = payload;
-        
-        #ifdef USE_ZLIB
-        if (config_.isCompressionEnabled() && !payload.empty() && 
-            (type == FrameType::TEXT || type == FrameType::BINARY)) {
-            data_to_send = compression_.compress(payload);
+        if (requeued) {
+            cv_.notify_all();
         }
-        #endif
-        
-        WebSocketFrame frame;
-        frame.setFin(true);
-        frame.setOpcode(static_cast<uint8_t>(type));
-        frame.setMasked(true);
-        frame.setPayload(data_to_send);
-        frame.setMaskKey(Utils::generateRandomString(4));
-        
-        std::string frame_data = frame.serialize();
-        return connection_.send(frame_data);
-    }
-
-    void sendCloseFrame() {
-        WebSocketFrame frame;
-        frame.setFin(true);
-        frame.setOpcode(static_cast<uint8_t>(FrameType::CLOSE));
-        frame.setMasked(true);
-        frame.setPayload("");
-        frame.setMaskKey(Utils::generateRandomString(4));
-        
-        std::string frame_data = frame.serialize();
-        connection_.send(frame_data);
     }
 
-    void onError(const WebSocketResult& result) {
-        if (error_callback_) {
-            error_callback_(result);
+    // 订阅未发出的主题从所在连接移回等待队列，期间已被迁移或退订的主题不动
+    void requeue(const std::shared_ptr<WebSocketClient>& client, const std::vector<std::string>& topics) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!running_) return;
+        for (const auto& topic : topics) {
+            auto it = assignment_.find(topic);
+            if (it == assignment_.end() || shards_[it->second]->client != client) continue;
+            shards_[it->second]->topics.erase(topic);
+            assignment_.erase(it);
+            unassigned_.insert(topic);
         }
     }
 
-    void onOpen() {
-        if (open_callback_) {
-            open_callback_();
-        }
-    }
+    // 监视连接：断开的连接把主题迁移到其他连接，按重连间隔重建后订阅剩下的主题
+    void superviseLoop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (running_) {
+            Batches batches;
+            auto now = std::chrono::steady_clock::now();
+
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                Shard& shard = *shards_[i];
+                if (shard.open && shard.client && shard.client->getState() != WebSocketState::OPEN) {
+                    shard.open = false;
+                    shard.retry_at = now;
+                    rebalanceFrom(i, batches);
+                }
+            }
+            assignUnassigned(batches);
+
+            for (size_t i = 0; i < shards_.size() && running_; ++i) {
+                if (shards_[i]->open || now < shards_[i]->retry_at) continue;
+
+                std::shared_ptr<WebSocketClient> old;
+                old.swap(shards_[i]->client);
+                shards_[i]->retry_at = now + std::chrono::milliseconds(config_.getReconnectDelay());
+                lock.unlock();
+                sendBatches(batches, true);
+                batches.clear();
+                old.reset();
+                std::shared_ptr<WebSocketClient> client;
+                bool connected = static_cast<bool>(openClient(i, client));
+                lock.lock();
+
+                if (connected && running_) {
+                    Shard& shard = *shards_[i];
+                    shard.client = client;
+                    shard.open = true;
+                    stats_.reconnects++;
+                    if (!shard.topics.empty()) {
+                        batches.push_back(std::make_pair(client, std::vector<std::string>(shard.topics.begin(), shard.topics.end())));
+                    }
+                    assignUnassigned(batches);
+                } else {
+                    lock.unlock();
+                    client.reset();
+                    lock.lock();
+                }
+            }
 
-    void onClose() {
-        if (close_callback_) {
-            close_callback_();
+            if (!batches.empty()) {
+                lock.unlock();
+                sendBatches(batches, true);
+                lock.lock();
+                continue;
+            }
+            cv_.wait_for(lock, std::chrono::milliseconds(50));
         }
     }
 
-    void onTextMessage(const std::string& message) {
-        if (text_message_callback_) {
-            text_message_callback_(message);
-        }
-    }
+    // 断开连接的主题迁移到其他有余量的连接，放不下的留在原连接等待重连，调用时持有mtx_
+    void rebalanceFrom(size_t index, Batches& batches) {
+        Shard& from = *shards_[index];
+        std::map<size_t, std::vector<std::string>> by_shard;
+        for (auto it = from.topics.begin(); it != from.topics.end();) {
+            size_t target = shards_.size();
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                const Shard& shard = *shards_[i];
+                if (i == index || !shard.open || shard.topics.size() >= options_.max_topics_per_connection) continue;
+                if (target == shards_.size() || shard.topics.size() < shards_[target]->topics.size()) {
+                    target = i;
+                }
+            }
+            if (target == shards_.size()) break;
 
-    void onBinaryMessage(const std::vector<uint8_t>& message) {
-        if (binary_message_callback_) {
-            binary_message_callback_(message);
+            shards_[target]->topics.insert(*it);
+            assignment_[*it] = target;
+            by_shard[target].push_back(*it);
+            stats_.rebalanced++;
+            it = from.topics.erase(it);
+        }
+        for (auto& item : by_shard) {
+            batches.push_back(std::make_pair(shards_[item.first]->client, std::move(item.second)));
         }
     }
 
-
-
-    std::atomic<WebSocketState> state_;
+    std::string url_;
+    SubscribeMessageBuilder subscribe_builder_;
+    SubscribeMessageBuilder unsubscribe_builder_;
+    SubscriptionManagerOptions options_;
     WebSocketConfig config_;
-    NetworkConnection connection_;
-    
-    #ifdef USE_ZLIB
-    Compression compression_;
-    #endif
-    
-    TaskRunner runner_;
+
+    bool running_;
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::thread supervisor_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::map<std::string, size_t> assignment_;  // 主题 -> 连接编号
+    std::set<std::string> unassigned_;
+    SubscriptionManagerStats stats_;
+
+    TaskRunner dispatcher_;
+    std::function<void(const std::string&, size_t)> message_callback_;
 };
 
 } // namespace websocket